@@ -27,6 +27,10 @@
 #include "config.h"
 #include "asm/types.h"
 
+#if defined(CONFIG_BOOTSTAGE) && !defined(CONFIG_BOOTSTAGE_MAX)
+#define CONFIG_BOOTSTAGE_MAX	32	/* boot stage stamps kept in gd */
+#endif
+
 /*
  * The following data structure is placed in some memory wich is
  * available very early after boot (like DPRAM on MPC8xx/MPC82xx, or
@@ -177,6 +181,17 @@ typedef	struct	global_data {
 #endif
 #if defined(CONFIG_WD_MAX_RATE)
 	unsigned long long wdt_last;	/* trace watch-dog triggering rate */
+#endif
+#ifdef CONFIG_BOOTSTAGE
+	/* boot stage stamps, kept here to survive relocation */
+	struct bootstage_record {
+		const char	*name;	/* NULL for init_sequence[] steps */
+		unsigned long	id;	/* the step's function address */
+		unsigned long long stamp;	/* timebase ticks */
+	} bootstage[CONFIG_BOOTSTAGE_MAX];
+	unsigned int	bootstage_count;
+	unsigned int	bootstage_dropped;	/* marks past CONFIG_BOOTSTAGE_MAX */
+	unsigned long long bootstage_offset;	/* ticks lost to init_timebase() */
 #endif
 	void		**jt;		/* jump table */
 	char		env_buf[32];	/* buffer for getenv() before reloc. */
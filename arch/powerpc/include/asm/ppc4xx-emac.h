@@ -57,9 +57,26 @@
 #define ENET_IPTYPE			0x800
 #define ARP_CACHE_SIZE			5
 
-#define NUM_TX_BUFF 1
 #define NUM_RX_BUFF PKTBUFSRX
 
+/*
+ * A MAL descriptor buffer holds at most 4080 bytes (the receive buffer
+ * size register counts 16 byte units in 8 bits), so larger frames are
+ * spread over several descriptors of MAL_BUF_SIZE bytes each. Receive
+ * descriptors are laid out back to back over the packet buffers, which
+ * keeps a frame contiguous in memory unless it wraps around the ring.
+ */
+#define MAL_BUF_MAX		4080
+#if PKTSIZE_ALIGN > MAL_BUF_MAX
+#define MAL_BUF_SIZE		2048
+#else
+#define MAL_BUF_SIZE		PKTSIZE_ALIGN
+#endif
+#define MAL_BUF_PER_PKT		(PKTSIZE_ALIGN / MAL_BUF_SIZE)
+
+#define NUM_TX_BUFF MAL_BUF_PER_PKT
+#define NUM_RX_DESC (NUM_RX_BUFF * MAL_BUF_PER_PKT)
+
 struct enet_frame {
    unsigned char	dest_addr[ENET_ADDR_LENGTH];
    unsigned char	source_addr[ENET_ADDR_LENGTH];
@@ -125,10 +142,16 @@ typedef struct emac_4xx_hw_st {
     int			tx_slot;	/* MAL Transmit Slot */
     int			tx_i_index;	/* Transmit Interrupt Queue Index */
     int			tx_u_index;		/* Transmit User Queue Index */
-    int			rx_ready[NUM_RX_BUFF];	/* Receive Ready Queue */
+    int			rx_ready[NUM_RX_DESC];	/* Receive Ready Queue */
+    int			rx_ready_len[NUM_RX_DESC]; /* Frame length */
     int			tx_run[NUM_TX_BUFF];	/* Transmit Running Queue */
     int			is_receiving;	/* sync with eth interrupt */
     int			print_speed;	/* print speed message upon start */
+#ifdef CONFIG_NET_KEEP_LINK
+    int			parked;		/* receiver off, rings and link kept */
+    int			link_speed;	/* link the EMAC was set up for */
+    int			link_duplex;
+#endif
     EMAC_STATS_ST	stats;
 } EMAC_4XX_HW_ST, *EMAC_4XX_HW_PST;
 
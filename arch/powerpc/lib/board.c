@@ -26,6 +26,7 @@
 #include <command.h>
 #include <malloc.h>
 #include <stdio_dev.h>
+#include <bootstage.h>
 #ifdef CONFIG_8xx
 #include <mpc8xx.h>
 #endif
@@ -392,10 +393,12 @@ void board_init_f (ulong bootflag)
 #endif
 
 	for (init_fnc_ptr = init_sequence; *init_fnc_ptr; ++init_fnc_ptr) {
+		bootstage_mark(NULL, (ulong)*init_fnc_ptr);
 		if ((*init_fnc_ptr) () != 0) {
 			hang ();
 		}
 	}
+	bootstage_mark("board_init_f", 0);
 
 	/*
 	 * Now that we have DRAM mapped and working, we can
@@ -644,6 +647,8 @@ void board_init_r (gd_t *id, ulong dest_addr)
 
 	gd->flags |= GD_FLG_RELOC;	/* tell others: relocation done */
 
+	bootstage_mark("board_init_r", 0);
+
 	/* The Malloc area is immediately below the monitor copy in DRAM */
 	malloc_start = dest_addr - TOTAL_MALLOC_LEN;
 
@@ -905,6 +910,7 @@ void board_init_r (gd_t *id, ulong dest_addr)
 
 #if defined(CONFIG_MISC_INIT_R)
 	/* miscellaneous platform dependent initialisations */
+	bootstage_mark("misc_init_r", 0);
 	misc_init_r ();
 #endif
 
@@ -969,6 +975,7 @@ void board_init_r (gd_t *id, ulong dest_addr)
 	WATCHDOG_RESET ();
 	puts ("Net:   ");
 #endif
+	bootstage_mark("eth_initialize", 0);
 	eth_initialize (bd);
 #endif
 
@@ -1011,6 +1018,7 @@ void board_init_r (gd_t *id, ulong dest_addr)
 	 * Interrupts) are up and running (i.e. the PC-style ISA
 	 * keyboard).
 	 */
+	bootstage_mark("last_stage_init", 0);
 	last_stage_init ();
 #endif
 
@@ -1063,6 +1071,8 @@ void board_init_r (gd_t *id, ulong dest_addr)
 
 	/* Initialization complete - start the monitor */
 
+	bootstage_mark("main_loop", 0);
+
 	/* main_loop() can return to retry autoboot, if so just run it again. */
 	for (;;) {
 		WATCHDOG_RESET ();
@@ -28,6 +28,7 @@
 #include <watchdog.h>
 #include <command.h>
 #include <image.h>
+#include <bootstage.h>
 #include <malloc.h>
 #include <u-boot/zlib.h>
 #include <bzlib.h>
@@ -278,6 +279,9 @@ static int boot_body_linux(bootm_headers_t *images)
 		/* Call the board-specific fixup routine */
 		ft_board_setup(*of_flat_tree, gd->bd);
 #endif
+#ifdef CONFIG_BOOTSTAGE
+		bootstage_fdt(*of_flat_tree);
+#endif
 
 		/* Delete the old LMB reservation */
 		lmb_free(lmb, (phys_addr_t)(u32)*of_flat_tree,
@@ -1,21 +1,23 @@
 #include <common.h>
 #include <net.h>
+#include <div64.h>
 
 #include <asm/processor.h>
 #include <asm/ppc4xx.h>
 
 #include "../include/bit.h"
 #include "../include/fpga.h"
+#include "../include/fpga_reg.h"
 
 static u32 ddr3_get_reg(u32 addr)
 {
-  return *((u32*)(CONFIG_SYS_FPGA_BASE + addr));
+  return fpga_read(FPGA_DDR3_BASE, addr);
 }
 
 
 void ddr3_set_reg(u32 addr, u32 val)
 {
-  *((u32*)(CONFIG_SYS_FPGA_BASE + addr)) = val;
+  fpga_write(FPGA_DDR3_BASE, addr, val);
 }
 
 static int ddr3_walking_zero_test(u32 flags)
@@ -225,6 +227,210 @@ static int ddr3_mem_test(u32 flags)
   return ret;
 }
 
+/*
+ * Full coverage test (subtest 2). The range and patterns are taken from
+ * the environment so a boot script can run a short smoke test and an
+ * operator a full soak:
+ *   ddr3start   first burst (hex, default 0)
+ *   ddr3len     number of bursts (hex, default to the end of the memory)
+ *   ddr3pattern addr, lfsr or all (default)
+ *   ddr3seed    lfsr seed (hex, default 1)
+ * Only the 16 full data words of a burst are written and checked, and a
+ * read is polled once per burst rather than once per word.
+ */
+#define DDR3_PAT_ADDR 0x1
+#define DDR3_PAT_LFSR 0x2
+
+/* bytes of data carried by one burst */
+#define DDR3_BURST_BYTES (BSP_DDR3_BURST_WORDS * 4)
+
+/* data word k of a burst, skipping the half width words */
+#define DDR3_WORD(k) ((k) + 1 + (k)/4)
+
+/* 32 bit galois lfsr, x^32 + x^22 + x^2 + x + 1 */
+static u32 ddr3_lfsr(u32 v)
+{
+  return (v >> 1) ^ (-(v & 1) & 0x80200003);
+}
+
+static ulong ddr3_env(char *name, ulong def)
+{
+  char *s = getenv(name);
+
+  return s ? simple_strtoul(s, NULL, 16) : def;
+}
+
+static int ddr3_full_pass(int pattern, u32 start, u32 len, u32 seed,
+                          unsigned long long *bytes)
+{
+  u32 i, j, k;
+  u32 d, t, lfsr;
+  struct fpga_reg_op wr[BSP_DDR3_BURST_WORDS], rd[BSP_DDR3_BURST_WORDS];
+  const char *name = pattern == DDR3_PAT_LFSR ? "lfsr" : "address";
+
+  for (k = 0; k < BSP_DDR3_BURST_WORDS; k++) {
+    wr[k].reg = BSP_DDR3_REG_WR(DDR3_WORD(k));
+    rd[k].reg = BSP_DDR3_REG_RD(DDR3_WORD(k));
+  }
+
+  lfsr = seed;
+  for (i = start; i < start + len; i++) {
+    for (k = 0; k < BSP_DDR3_BURST_WORDS; k++) {
+      if (pattern == DDR3_PAT_LFSR)
+        wr[k].val = lfsr = ddr3_lfsr(lfsr);
+      else
+        wr[k].val = (i << 4) | k;
+    }
+    ddr3_set_reg(BSP_DDR3_REG_ADDR, i << 3);
+    fpga_write_batch(FPGA_DDR3_BASE, wr, BSP_DDR3_BURST_WORDS);
+    ddr3_set_reg(BSP_DDR3_REG_CTRL, BSP_DDR3_WR);
+
+    if (!(i & 0xffff) && bit_abort())
+      return -1;
+  }
+
+  lfsr = seed;
+  for (i = start; i < start + len; i++) {
+    ddr3_set_reg(BSP_DDR3_REG_ADDR, i << 3);
+    ddr3_set_reg(BSP_DDR3_REG_CTRL, BSP_DDR3_RD);
+    for (j=0; j < 1000; j++){
+      if (!(ddr3_get_reg(BSP_DDR3_REG_CTRL) & BSP_DDR3_RD)){
+        break;
+      }
+      if (j == 999) {
+        sprintf(bit_strerr, "timeout waiting for read to be completed");
+        return -1;
+      }
+    }
+
+    fpga_read_batch(FPGA_DDR3_BASE, rd, BSP_DDR3_BURST_WORDS);
+    for (k = 0; k < BSP_DDR3_BURST_WORDS; k++) {
+      if (pattern == DDR3_PAT_LFSR)
+        d = lfsr = ddr3_lfsr(lfsr);
+      else
+        d = (i << 4) | k;
+      t = rd[k].val;
+      if (t != d) {
+        sprintf(bit_strerr, "%s test, readback error at addr %x[%d] in data burst, got %x, expected %x",
+                name, i, k, t, d);
+        return -1;
+      }
+    }
+
+    if (!(i & 0xffff) && bit_abort())
+      return -1;
+  }
+
+  /* a full depth pass is 4GB, past a ulong */
+  *bytes += 2ULL * len * DDR3_BURST_BYTES;
+  return 0;
+}
+
+/*
+ * BSP_DDR3_DEPTH is not read from the gateware, so check it: a tag is
+ * left in burst 0 and a write made at every power of two burst below
+ * the depth; a gateware decoding fewer address bits wraps one of those
+ * onto burst 0.
+ */
+#define DDR3_DEPTH_TAG 0xd3d3d3d3
+
+static void ddr3_put_burst(u32 burst, u32 val)
+{
+  ddr3_set_reg(BSP_DDR3_REG_ADDR, burst << 3);
+  ddr3_set_reg(BSP_DDR3_REG_WR(DDR3_WORD(0)), val);
+  ddr3_set_reg(BSP_DDR3_REG_CTRL, BSP_DDR3_WR);
+}
+
+static int ddr3_get_burst(u32 burst, u32 *val)
+{
+  int j;
+
+  ddr3_set_reg(BSP_DDR3_REG_ADDR, burst << 3);
+  ddr3_set_reg(BSP_DDR3_REG_CTRL, BSP_DDR3_RD);
+  for (j=0; j < 1000; j++){
+    if (!(ddr3_get_reg(BSP_DDR3_REG_CTRL) & BSP_DDR3_RD)){
+      *val = ddr3_get_reg(BSP_DDR3_REG_RD(DDR3_WORD(0)));
+      return 0;
+    }
+  }
+  sprintf(bit_strerr, "timeout waiting for read to be completed");
+  return -1;
+}
+
+static int ddr3_depth_check(void)
+{
+  u32 burst, t;
+
+  ddr3_put_burst(0, DDR3_DEPTH_TAG);
+  for (burst = 1; burst < BSP_DDR3_DEPTH; burst <<= 1) {
+    ddr3_put_burst(burst, burst);
+    if (ddr3_get_burst(0, &t))
+      return -1;
+    if (t != DDR3_DEPTH_TAG) {
+      sprintf(bit_strerr, "gateware decodes only %x bursts, BSP_DDR3_DEPTH is %x",
+              burst, BSP_DDR3_DEPTH);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static int ddr3_full_test(u32 flags)
+{
+  u32 start, len, seed;
+  int pattern, p;
+  unsigned long long bytes;
+  ulong ms, rate;
+  char *s;
+
+  start = ddr3_env("ddr3start", 0);
+  if (start >= BSP_DDR3_DEPTH) {
+    sprintf(bit_strerr, "start burst %x beyond depth %x", start, BSP_DDR3_DEPTH);
+    return -1;
+  }
+  len = ddr3_env("ddr3len", BSP_DDR3_DEPTH - start);
+  if (len > BSP_DDR3_DEPTH - start)
+    len = BSP_DDR3_DEPTH - start;
+  seed = ddr3_env("ddr3seed", 1);
+  if (!seed)
+    seed = 1;
+
+  s = getenv("ddr3pattern");
+  if (!s || !strcmp(s, "all"))
+    pattern = DDR3_PAT_ADDR | DDR3_PAT_LFSR;
+  else if (!strcmp(s, "addr"))
+    pattern = DDR3_PAT_ADDR;
+  else if (!strcmp(s, "lfsr"))
+    pattern = DDR3_PAT_LFSR;
+  else {
+    sprintf(bit_strerr, "unknown pattern %s", s);
+    return -1;
+  }
+
+  if (ddr3_depth_check())
+    return -1;
+
+  for (p = DDR3_PAT_ADDR; p <= DDR3_PAT_LFSR; p <<= 1) {
+    if (!(pattern & p))
+      continue;
+
+    bytes = 0;
+    ms = get_timer(0);
+    if (ddr3_full_pass(p, start, len, seed, &bytes))
+      return -1;
+    ms = get_timer(ms);
+
+    /* bytes per ms is KB/s; scale to hundredths of MB/s */
+    rate = ms ? lldiv(bytes, ms) / 10 : 0;
+    printf("ddr3: %s: bursts %x-%x (%lu%% coverage), %llu bytes in %lu ms, %lu.%02lu MB/s\n",
+           p == DDR3_PAT_LFSR ? "lfsr" : "address", start, start + len - 1,
+           (ulong)(len / (BSP_DDR3_DEPTH / 100)),
+           bytes, ms, rate / 100, rate % 100);
+  }
+
+  return 0;
+}
+
 static int ddr3_cal_test(u32 flags)
 {
   u32 status = ddr3_get_reg(BSP_DDR3_REG_STATUS);
@@ -243,6 +449,8 @@ int bit_ddr3(int which, int subtest, u32 flags)
   case 1:
     return ddr3_mem_test(flags);
   case 2:
+    return ddr3_full_test(flags);
+  case 3:
     sprintf(bit_strerr, "test not implemented");
     return -1;
   default:
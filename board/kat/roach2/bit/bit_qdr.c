@@ -1,11 +1,13 @@
 #include <common.h>
 #include <net.h>
+#include <div64.h>
 
 #include <asm/processor.h>
 #include <asm/ppc4xx.h>
 
 #include "../include/bit.h"
 #include "../include/fpga.h"
+#include "../include/fpga_reg.h"
 
 /***************************** QDR  *******************************/
 
@@ -13,42 +15,12 @@
 
 static void qdr_set_reg(int which, u32 reg, u32 val)
 {
-  u32 offset = CONFIG_SYS_FPGA_BASE;
-  switch (which){
-     case 0:
-       offset += BSP_QDR0CONF_OFFSET;
-       break;
-     case 1:
-       offset += BSP_QDR1CONF_OFFSET;
-       break;
-     case 2:
-       offset += BSP_QDR2CONF_OFFSET;
-       break;
-     default:
-       offset += BSP_QDR3CONF_OFFSET;
-  }
-  offset += reg;
-  *((volatile u32 *) (offset)) = val;
+  fpga_write(FPGA_QDRCONF_BASE(which), reg, val);
 }
 
 static u32 qdr_get_reg(int which, u32 reg)
 {
-  u32 offset = CONFIG_SYS_FPGA_BASE;
-  switch (which){
-     case 0:
-       offset += BSP_QDR0CONF_OFFSET;
-       break;
-     case 1:
-       offset += BSP_QDR1CONF_OFFSET;
-       break;
-     case 2:
-       offset += BSP_QDR2CONF_OFFSET;
-       break;
-     default:
-       offset += BSP_QDR3CONF_OFFSET;
-  }
-  offset += reg;
-  return *((volatile u32 *) (offset));
+  return fpga_read(FPGA_QDRCONF_BASE(which), reg);
 }
 
 static void qdr_dll_reset(int which)
@@ -111,15 +83,18 @@ static int qdr_phy_tick_dly(int which, int dir)
   the bit by a whole cycle to get 2's.
 */
 
-static int qdr_align_bit(int which, int bit, u32 flag)
+/* classify a status sample: a stable 1 or 2, or 0xb for a bad sample */
+static u8 qdr_sample(u32 dreg)
 {
-  int i;
-  u32 dreg;
-  int val;
-  int is_stable;
-  int ret=0;
+  int val = dreg % 4;
 
-  u8 bit_line[32];
+  return (dreg & 0x00000100) && (val == 1 || val == 2) ? val : 0xb;
+}
+
+/* pick the calibration point from the 32 tap samples of a bit */
+static int qdr_find_cal_pos(u8 *bit_line)
+{
+  int i;
   u8 stable_count = 0;
   u8 baddies = 0;
   int first_val = 0;
@@ -127,22 +102,6 @@ static int qdr_align_bit(int which, int bit, u32 flag)
 
   int cal_pos = EDGE_CLEARANCE; /* default value if no transition is detected */
 
-  qdr_set_reg(which, BSP_QDRCONF_REG_BITINDEX, (u32)bit);
-  qdr_set_reg(which, BSP_QDRCONF_REG_BITCTRL, BSP_QDRCONF_DLY_RST);
-  udelay(10);
-
-  /* ensure that the status register is valid */
-  qdr_phy_tick_dly(which, 1);
-  qdr_phy_tick_dly(which, 0);
-
-  for (i=0; i < 32; i++) {
-    dreg = qdr_get_reg(which, BSP_QDRCONF_REG_STATUS);
-    is_stable = dreg & 0x00000100;
-    val = dreg % 4;
-    bit_line[i] = is_stable && (val == 1 || val == 2) ? val : 0xb;
-    qdr_phy_tick_dly(which, 1);
-  }
-
   for (i=0; i < 32; i++) {
     if (bit_line[i] != 0xb){
       if (!first_val){
@@ -173,21 +132,21 @@ static int qdr_align_bit(int which, int bit, u32 flag)
     prev_val = bit_line[i];
   }
 
-  /* dump the bit */
-  if (flag & 0x1) {
-    for (i=0; i < 32; i++) {
-      switch (bit_line[i]){
-      case 1:
-        printf("1");
-        break;
-      case 2:
-        printf("2");
-        break;
-      default:
-        printf("x");
-      } 
-    }
-  }
+  return cal_pos;
+}
+
+/*
+ * Set the delay of the selected bit to cal_pos taps and apply half bit
+ * alignment. Fails if the bit does not settle on a valid value there.
+ */
+static int qdr_set_bit_tap(int which, int bit, int cal_pos, int *pval)
+{
+  int i;
+  u32 dreg;
+  int val;
+  int is_stable;
+
+  qdr_set_reg(which, BSP_QDRCONF_REG_BITINDEX, (u32)bit);
 
   /* reset the delay elements to 0 offset */
   qdr_set_reg(which, BSP_QDRCONF_REG_BITCTRL, BSP_QDRCONF_DLY_RST);
@@ -208,10 +167,60 @@ static int qdr_align_bit(int which, int bit, u32 flag)
     qdr_set_reg(which, BSP_QDRCONF_REG_BITCTRL, BSP_QDRCONF_ALIGN_EN);
   }
 
+  *pval = val;
   if (!is_stable || val == 0 || val == 3){
     sprintf(bit_strerr, "calibrated data bit unstable or has bad value");
-    ret = 1;
-  } else {
+    return 1;
+  }
+  return 0;
+}
+
+static int qdr_align_bit(int which, int bit, u32 flag, u8 *tap)
+{
+  int i;
+  u32 dreg;
+  int val;
+  int ret=0;
+
+  u8 bit_line[32];
+  int cal_pos;
+
+  qdr_set_reg(which, BSP_QDRCONF_REG_BITINDEX, (u32)bit);
+  qdr_set_reg(which, BSP_QDRCONF_REG_BITCTRL, BSP_QDRCONF_DLY_RST);
+  udelay(10);
+
+  /* ensure that the status register is valid */
+  qdr_phy_tick_dly(which, 1);
+  qdr_phy_tick_dly(which, 0);
+
+  for (i=0; i < 32; i++) {
+    dreg = qdr_get_reg(which, BSP_QDRCONF_REG_STATUS);
+    bit_line[i] = qdr_sample(dreg);
+    qdr_phy_tick_dly(which, 1);
+  }
+
+  cal_pos = qdr_find_cal_pos(bit_line);
+
+  /* dump the bit */
+  if (flag & 0x1) {
+    for (i=0; i < 32; i++) {
+      switch (bit_line[i]){
+      case 1:
+        printf("1");
+        break;
+      case 2:
+        printf("2");
+        break;
+      default:
+        printf("x");
+      } 
+    }
+  }
+
+  *tap = cal_pos < 0 ? 0 : cal_pos; /* negative positions apply no delay */
+  ret = qdr_set_bit_tap(which, bit, cal_pos, &val);
+
+  if (!ret) {
     if (flag & 0x1) {
       printf("\n");
       for (i=0; i <= 31; i++) {
@@ -231,6 +240,70 @@ static int qdr_align_bit(int which, int bit, u32 flag)
   return ret;
 }
 
+/*
+ * Calibration results are kept in qdr<which>cal as
+ * "<major>.<minor>.<rcs>:<36 two digit hex taps>". They are only reused
+ * against the same FPGA build; a stale or failing set falls back to the
+ * full sweep.
+ */
+#define QDR_CAL_BITS 36
+
+static void qdr_cal_key(char *buf)
+{
+  u32 offset = CONFIG_SYS_FPGA_BASE;
+
+  sprintf(buf, "%x.%x.%x",
+          *((volatile u32 *)(offset + BSP_REG_REVMAJ)),
+          *((volatile u32 *)(offset + BSP_REG_REVMIN)),
+          *((volatile u32 *)(offset + BSP_REG_REVRCS)));
+}
+
+static int qdr_cal_load(int which, u8 *taps)
+{
+  char name[8], key[32];
+  char *s, *p;
+  int i, klen;
+
+  sprintf(name, "qdr%dcal", which);
+  if ((s = getenv(name)) == NULL)
+    return -1;
+
+  qdr_cal_key(key);
+  klen = strlen(key);
+  if (strncmp(s, key, klen) || s[klen] != ':' ||
+      strlen(s + klen + 1) != QDR_CAL_BITS * 2)
+    return -1;
+
+  p = s + klen + 1;
+  for (i=0; i < QDR_CAL_BITS; i++) {
+    char hex[3] = {p[2*i], p[2*i + 1], '\0'};
+    taps[i] = simple_strtoul(hex, NULL, 16);
+    if (taps[i] > 31)
+      return -1;
+  }
+  return 0;
+}
+
+static void qdr_cal_store(int which, u8 *taps)
+{
+  char name[8], val[32 + 1 + QDR_CAL_BITS * 2 + 1];
+  char *s;
+  int i, len;
+
+  sprintf(name, "qdr%dcal", which);
+  qdr_cal_key(val);
+  len = strlen(val);
+  val[len++] = ':';
+  for (i=0; i < QDR_CAL_BITS; i++)
+    len += sprintf(val + len, "%02x", taps[i]);
+
+  s = getenv(name);
+  if (s && !strcmp(s, val))
+    return;
+  setenv(name, val);
+  printf("info: stored qdr%d calibration, saveenv to reuse it after reset\n", which);
+}
+
 static void qdr_dump_bit(int which, int bit)
 {
   int i;
@@ -270,9 +343,9 @@ static void qdr_dump_bit(int which, int bit)
   printf("\n");
 }
 
-static int qdr_phy_cal(int which, u32 flags)
+static int qdr_phy_cal(int which, u32 flags, u8 *taps)
 {
-  int i;
+  int i, val;
   int ret=0;
   u32 dreg;
 
@@ -292,58 +365,236 @@ static int qdr_phy_cal(int which, u32 flags)
     }
   }
 
-  for (i=0; i < 36; i++) {
-    ret = qdr_align_bit(which, i, flags);
+  /* fast path: apply and verify the taps found for this build last time */
+  if (!(flags & 0x4) && !qdr_cal_load(which, taps)) {
+    for (i=0; i < QDR_CAL_BITS; i++) {
+      if (qdr_set_bit_tap(which, i, taps[i], &val))
+        break;
+    }
+    if (i == QDR_CAL_BITS)
+      goto done;
+    if (flags & 0x1)
+      printf("stored calibration failed on bit %d, running full sweep\n", i);
+  }
+
+  for (i=0; i < QDR_CAL_BITS; i++) {
+    ret = qdr_align_bit(which, i, flags, &taps[i]);
     if (ret)
       break;
   }
 
+  if (!ret)
+    qdr_cal_store(which, taps);
+
+done:
   /* disable calibration logic */
   qdr_set_reg(which, BSP_QDRCONF_REG_CTRL, BSP_QDRCONF_DLL_RUN);
 
   return ret;
 }
 
+/*
+ * Interleaved calibration of all four controllers. The QDRCONF blocks
+ * are independent, so every step (DLL reset, delay reset, tap step,
+ * status poll) is issued to each active controller in turn and the
+ * settle times are shared instead of serialised. The per-bit analysis
+ * is the same as the sequential sweep, so the chosen taps match.
+ */
+#define QDR_COUNT 4
+
+/* step the delay of every controller in mask and wait for all of them */
+static int qdr_multi_tick_dly(int mask, int dir)
+{
+  int which, i, pending = mask;
+
+  for (which=0; which < QDR_COUNT; which++) {
+    if (mask & (1 << which))
+      qdr_set_reg(which, BSP_QDRCONF_REG_BITCTRL, BSP_QDRCONF_DLY_EN |
+                              (dir ? BSP_QDRCONF_DLY_INC : BSP_QDRCONF_DLY_DEC));
+  }
+
+  for (i=0; i < 1000 && pending; i++) {
+    for (which=0; which < QDR_COUNT; which++) {
+      if ((pending & (1 << which)) &&
+          (qdr_get_reg(which, BSP_QDRCONF_REG_STATUS) & BSP_QDRCONF_DAT_RDY))
+        pending &= ~(1 << which);
+    }
+  }
+
+  if (pending) {
+    sprintf(bit_strerr, "calibration data done stuck low");
+    return 1;
+  }
+  return 0;
+}
+
+static int qdr_cal_interleaved(u8 taps[QDR_COUNT][QDR_CAL_BITS])
+{
+  u8 bit_line[QDR_COUNT][32];
+  int cal_pos[QDR_COUNT];
+  int which, bit, i, val, max_pos;
+  int active = (1 << QDR_COUNT) - 1, pending;
+  u32 dreg;
+
+  /* overlapped dll reset */
+  for (which=0; which < QDR_COUNT; which++)
+    qdr_set_reg(which, BSP_QDRCONF_REG_CTRL, BSP_QDRCONF_DLL_RESET);
+  udelay(1000);
+  for (which=0; which < QDR_COUNT; which++)
+    qdr_set_reg(which, BSP_QDRCONF_REG_CTRL, BSP_QDRCONF_DLL_RUN);
+  udelay(1000);
+
+  /* enable calibration logic */
+  for (which=0; which < QDR_COUNT; which++)
+    qdr_set_reg(which, BSP_QDRCONF_REG_CTRL, BSP_QDRCONF_CAL_EN | BSP_QDRCONF_DLL_RUN);
+
+  pending = active;
+  for (i=0; i < 1000 && pending; i++) {
+    for (which=0; which < QDR_COUNT; which++) {
+      if ((pending & (1 << which)) &&
+          (qdr_get_reg(which, BSP_QDRCONF_REG_STATUS) & BSP_QDRCONF_CAL_RDY))
+        pending &= ~(1 << which);
+    }
+  }
+  if (pending) {
+    sprintf(bit_strerr, "cal state machine not ready (qdr mask %x)", pending);
+    active = 0;
+  }
+
+  for (bit=0; bit < QDR_CAL_BITS && active; bit++) {
+    for (which=0; which < QDR_COUNT; which++) {
+      if (!(active & (1 << which)))
+        continue;
+      qdr_set_reg(which, BSP_QDRCONF_REG_BITINDEX, (u32)bit);
+      qdr_set_reg(which, BSP_QDRCONF_REG_BITCTRL, BSP_QDRCONF_DLY_RST);
+    }
+    udelay(10);
+
+    /* ensure that the status registers are valid */
+    qdr_multi_tick_dly(active, 1);
+    qdr_multi_tick_dly(active, 0);
+
+    for (i=0; i < 32; i++) {
+      for (which=0; which < QDR_COUNT; which++) {
+        if (active & (1 << which))
+          bit_line[which][i] = qdr_sample(qdr_get_reg(which, BSP_QDRCONF_REG_STATUS));
+      }
+      qdr_multi_tick_dly(active, 1);
+    }
+
+    /* reset the delay elements and step each controller to its cal_pos */
+    max_pos = 0;
+    for (which=0; which < QDR_COUNT; which++) {
+      if (!(active & (1 << which)))
+        continue;
+      cal_pos[which] = qdr_find_cal_pos(bit_line[which]);
+      if (cal_pos[which] < 0)
+        cal_pos[which] = 0;
+      taps[which][bit] = cal_pos[which];
+      if (cal_pos[which] > max_pos)
+        max_pos = cal_pos[which];
+      qdr_set_reg(which, BSP_QDRCONF_REG_BITCTRL, BSP_QDRCONF_DLY_RST);
+    }
+    udelay(10);
+
+    for (i=0; i < max_pos; i++) {
+      pending = 0;
+      for (which=0; which < QDR_COUNT; which++) {
+        if ((active & (1 << which)) && i < cal_pos[which])
+          pending |= 1 << which;
+      }
+      qdr_multi_tick_dly(pending, 1);
+    }
+
+    /* now get half bit alignment */
+    udelay(10);
+    for (which=0; which < QDR_COUNT; which++) {
+      if (!(active & (1 << which)))
+        continue;
+      dreg = qdr_get_reg(which, BSP_QDRCONF_REG_STATUS);
+      val = dreg % 4;
+      if (val == 1)
+        qdr_set_reg(which, BSP_QDRCONF_REG_BITCTRL, BSP_QDRCONF_ALIGN_EN);
+      if (!(dreg & BSP_QDRCONF_DAT_STABLE) || val == 0 || val == 3) {
+        sprintf(bit_strerr, "qdr%d calibrated data bit %d unstable or has bad value",
+                which, bit);
+        active &= ~(1 << which);
+      }
+    }
+  }
+
+  /* disable calibration logic */
+  for (which=0; which < QDR_COUNT; which++)
+    qdr_set_reg(which, BSP_QDRCONF_REG_CTRL, BSP_QDRCONF_DLL_RUN);
+
+  return active == (1 << QDR_COUNT) - 1 ? 0 : -1;
+}
+
+static ulong qdr_ticks_to_us(unsigned long long ticks)
+{
+  return lldiv(ticks, get_tbclk() / 1000000);
+}
+
+/*
+ * Calibrate all controllers at once (flag 0x8). With flag 0x10 the
+ * sequential sweep is run first for comparison of timing and taps.
+ */
+static int qdr_phy_cal_all(u32 flags)
+{
+  u8 taps[QDR_COUNT][QDR_CAL_BITS];
+  u8 ref[QDR_COUNT][QDR_CAL_BITS];
+  unsigned long long start, seq = 0, ilv;
+  ulong seq_us, ilv_us;
+  int which, bit;
+
+  if (flags & 0x10) {
+    start = get_ticks();
+    for (which=0; which < QDR_COUNT; which++) {
+      if (qdr_phy_cal(which, (flags & ~0x1) | 0x4, ref[which]))
+        return -1;
+    }
+    seq = get_ticks() - start;
+  }
+
+  start = get_ticks();
+  if (qdr_cal_interleaved(taps))
+    return -1;
+  ilv = get_ticks() - start;
+
+  for (which=0; which < QDR_COUNT; which++)
+    qdr_cal_store(which, taps[which]);
+
+  ilv_us = qdr_ticks_to_us(ilv);
+  printf("interleaved calibration: %llu ticks (%lu us)\n", ilv, ilv_us);
+  if (!seq)
+    return 0;
+
+  seq_us = qdr_ticks_to_us(seq);
+  if (!ilv_us)
+    ilv_us = 1;
+  printf("sequential calibration:  %llu ticks (%lu us), speedup x%lu.%02lu\n",
+         seq, seq_us, seq_us / ilv_us, (seq_us * 100 / ilv_us) % 100);
+
+  for (which=0; which < QDR_COUNT; which++) {
+    for (bit=0; bit < QDR_CAL_BITS; bit++) {
+      if (taps[which][bit] != ref[which][bit])
+        printf("warning: qdr%d bit %d tap %d, sequential sweep chose %d\n",
+               which, bit, taps[which][bit], ref[which][bit]);
+    }
+  }
+  return 0;
+}
+
 /******* MEM ********/
 
 static void qdr_mem_set_reg(int which, u32 reg, u32 val)
 {
-  u32 offset = CONFIG_SYS_FPGA_BASE;
-  switch (which){
-     case 0:
-       offset += BSP_QDR0_OFFSET;
-       break;
-     case 1:
-       offset += BSP_QDR1_OFFSET;
-       break;
-     case 2:
-       offset += BSP_QDR2_OFFSET;
-       break;
-     default:
-       offset += BSP_QDR3_OFFSET;
-  }
-  offset += reg;
-  *((volatile u32 *) (offset)) = val;
+  fpga_write(FPGA_QDR_BASE(which), reg, val);
 }
 
 static u32 qdr_mem_get_reg(int which, u32 reg)
 {
-  u32 offset = CONFIG_SYS_FPGA_BASE;
-  switch (which){
-     case 0:
-       offset += BSP_QDR0_OFFSET;
-       break;
-     case 1:
-       offset += BSP_QDR1_OFFSET;
-       break;
-     case 2:
-       offset += BSP_QDR2_OFFSET;
-       break;
-     default:
-       offset += BSP_QDR3_OFFSET;
-  }
-  offset += reg;
-  return *((volatile u32 *) (offset));
+  return fpga_read(FPGA_QDR_BASE(which), reg);
 }
 
 static int qdr_mem_test(int which, u32 flags)
@@ -351,6 +602,9 @@ static int qdr_mem_test(int which, u32 flags)
   u32 i, j;
   u32 d, t;
   int ret = 0;
+
+  /* the data registers may have been written behind the cache */
+  fpga_reg_invalidate();
   d = qdr_mem_get_reg(which, BSP_QDRM_REG_STAT);
 
   if (!(d & BSP_QDRM_PHYRDY)) {
@@ -367,13 +621,13 @@ static int qdr_mem_test(int which, u32 flags)
   for (i=0; i < 144; i++){
     qdr_mem_set_reg(which, BSP_QDRM_REG_A, i);
 
-    qdr_mem_set_reg(which, BSP_QDRM_REG_D + 0, 0xffffffff);
-    qdr_mem_set_reg(which, BSP_QDRM_REG_D + 4, 0xffffffff);
-    qdr_mem_set_reg(which, BSP_QDRM_REG_D + 8, 0xffffffff);
-    qdr_mem_set_reg(which, BSP_QDRM_REG_D + 12, 0xffffffff);
-    qdr_mem_set_reg(which, BSP_QDRM_REG_D + 16, 0xffffffff);
+    fpga_write_cached(FPGA_QDR_BASE(which), BSP_QDRM_REG_D + 0, 0xffffffff);
+    fpga_write_cached(FPGA_QDR_BASE(which), BSP_QDRM_REG_D + 4, 0xffffffff);
+    fpga_write_cached(FPGA_QDR_BASE(which), BSP_QDRM_REG_D + 8, 0xffffffff);
+    fpga_write_cached(FPGA_QDR_BASE(which), BSP_QDRM_REG_D + 12, 0xffffffff);
+    fpga_write_cached(FPGA_QDR_BASE(which), BSP_QDRM_REG_D + 16, 0xffffffff);
 
-    qdr_mem_set_reg(which, BSP_QDRM_REG_D + (BSP_QDRM_DLEN - 1 - (i/32))*4, ~(1 << (i % 32)));
+    fpga_write_cached(FPGA_QDR_BASE(which), BSP_QDRM_REG_D + (BSP_QDRM_DLEN - 1 - (i/32))*4, ~(1 << (i % 32)));
 
     qdr_mem_set_reg(which, BSP_QDRM_REG_CTRL, BSP_QDRM_WREN);
 
@@ -427,13 +681,13 @@ static int qdr_mem_test(int which, u32 flags)
   for (i=0; i < 144; i++){
     qdr_mem_set_reg(which, BSP_QDRM_REG_A, i);
 
-    qdr_mem_set_reg(which, BSP_QDRM_REG_D + 0, 0);
-    qdr_mem_set_reg(which, BSP_QDRM_REG_D + 4, 0);
-    qdr_mem_set_reg(which, BSP_QDRM_REG_D + 8, 0);
-    qdr_mem_set_reg(which, BSP_QDRM_REG_D + 12, 0);
-    qdr_mem_set_reg(which, BSP_QDRM_REG_D + 16, 0);
+    fpga_write_cached(FPGA_QDR_BASE(which), BSP_QDRM_REG_D + 0, 0);
+    fpga_write_cached(FPGA_QDR_BASE(which), BSP_QDRM_REG_D + 4, 0);
+    fpga_write_cached(FPGA_QDR_BASE(which), BSP_QDRM_REG_D + 8, 0);
+    fpga_write_cached(FPGA_QDR_BASE(which), BSP_QDRM_REG_D + 12, 0);
+    fpga_write_cached(FPGA_QDR_BASE(which), BSP_QDRM_REG_D + 16, 0);
 
-    qdr_mem_set_reg(which, BSP_QDRM_REG_D + (BSP_QDRM_DLEN - 1 - (i/32))*4, (1 << (i % 32)));
+    fpga_write_cached(FPGA_QDR_BASE(which), BSP_QDRM_REG_D + (BSP_QDRM_DLEN - 1 - (i/32))*4, (1 << (i % 32)));
 
     qdr_mem_set_reg(which, BSP_QDRM_REG_CTRL, BSP_QDRM_WREN);
 
@@ -522,6 +776,193 @@ static int qdr_mem_test(int which, u32 flags)
   return 0;
 }
 
+/*
+ * Full depth march tests (subtest 2). The patterns are selected with
+ * flags 0x100 (March C-), 0x200 (checkerboard) and 0x400 (address in
+ * address), all three when none is given; 0x20 limits the run to
+ * BSP_QDRM_DEPTH entries. Within a march element the data registers
+ * are only rewritten when the pattern changes, so a write costs an
+ * address and a control access.
+ */
+#define QDR_MARCH_C     0x100
+#define QDR_MARCH_CHECK 0x200
+#define QDR_MARCH_ADDR  0x400
+#define QDR_MARCH_ALL   (QDR_MARCH_C | QDR_MARCH_CHECK | QDR_MARCH_ADDR)
+
+/* bytes in one 144 bit entry */
+#define QDR_ENTRY_BYTES 18
+
+
+static void qdr_m_set_data(u32 m, u32 d)
+{
+  fpga_fill_block(m, BSP_QDRM_REG_D, d, BSP_QDRM_DLEN);
+}
+
+static void qdr_m_write(u32 m, u32 addr)
+{
+  fpga_write(m, BSP_QDRM_REG_A, addr);
+  fpga_write(m, BSP_QDRM_REG_CTRL, BSP_QDRM_WREN);
+}
+
+/* read an entry and compare it with d in every word */
+static int qdr_m_check(u32 m, u32 addr, u32 d, const char *name)
+{
+  u32 q[BSP_QDRM_DLEN];
+  u32 t, e;
+  int j;
+
+  fpga_write(m, BSP_QDRM_REG_A, addr);
+  fpga_write(m, BSP_QDRM_REG_CTRL, BSP_QDRM_RDEN);
+  for (j=0; j < 1000; j++){
+    if (!(fpga_read(m, BSP_QDRM_REG_CTRL) & BSP_QDRM_RDEN))
+      break;
+    if (j == 999) {
+      sprintf(bit_strerr, "%s: timeout waiting for read to be completed", name);
+      return -1;
+    }
+  }
+
+  fpga_read_block(m, BSP_QDRM_REG_Q, q, BSP_QDRM_DLEN);
+  for (j=0; j < BSP_QDRM_DLEN; j++){
+    t = q[j];
+    e = j == 0 ? d & 0xffff : d;
+    if (t != e){
+      sprintf(bit_strerr, "%s: data mismatch: addr = %x, offset=%d, got=%x, expected=%x",
+              name, addr, j, t, e);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/*
+ * One march element over the whole depth: optionally read back rd, then
+ * write wr. up selects the address order.
+ */
+static int qdr_march_element(u32 m, u32 depth, int up, int check,
+                             u32 rd, int write, u32 wr, ulong *bytes)
+{
+  u32 i, addr;
+
+  if (write)
+    qdr_m_set_data(m, wr);
+
+  for (i=0; i < depth; i++){
+    addr = up ? i : depth - 1 - i;
+    if (check && qdr_m_check(m, addr, rd, "march c-"))
+      return -1;
+    if (write)
+      qdr_m_write(m, addr);
+    if (!(i & 0xffff) && bit_abort())
+      return -1;
+  }
+  *bytes += depth * QDR_ENTRY_BYTES * (!!check + !!write);
+  return 0;
+}
+
+static int qdr_march_c(u32 m, u32 depth, ulong *bytes)
+{
+  /* {(w0); up(r0,w1); up(r1,w0); down(r0,w1); down(r1,w0); (r0)} */
+  if (qdr_march_element(m, depth, 1, 0, 0, 1, 0, bytes) ||
+      qdr_march_element(m, depth, 1, 1, 0, 1, ~0, bytes) ||
+      qdr_march_element(m, depth, 1, 1, ~0, 1, 0, bytes) ||
+      qdr_march_element(m, depth, 0, 1, 0, 1, ~0, bytes) ||
+      qdr_march_element(m, depth, 0, 1, ~0, 1, 0, bytes) ||
+      qdr_march_element(m, depth, 1, 1, 0, 0, 0, bytes))
+    return -1;
+  return 0;
+}
+
+/* pattern for address i: checkerboard (inv selects the phase) or address */
+static u32 qdr_march_pattern(int type, u32 i, int inv)
+{
+  u32 d;
+
+  if (type == QDR_MARCH_CHECK)
+    d = (i & 1) ? 0xaaaaaaaa : 0x55555555;
+  else
+    d = i;
+  return inv ? ~d : d;
+}
+
+static int qdr_march_fill(u32 m, u32 depth, int type, const char *name, ulong *bytes)
+{
+  u32 i;
+  int inv;
+
+  for (inv=0; inv < 2; inv++){
+    for (i=0; i < depth; i++){
+      qdr_m_set_data(m, qdr_march_pattern(type, i, inv));
+      qdr_m_write(m, i);
+    }
+    for (i=0; i < depth; i++){
+      if (qdr_m_check(m, i, qdr_march_pattern(type, i, inv), name))
+        return -1;
+      if (!(i & 0xffff) && bit_abort())
+        return -1;
+    }
+    *bytes += 2 * depth * QDR_ENTRY_BYTES;
+  }
+  return 0;
+}
+
+static void qdr_march_report(int which, const char *name, ulong bytes, ulong ms)
+{
+  /* bytes per ms is KB/s; scale to hundredths of MB/s */
+  ulong rate = ms ? (bytes / ms) / 10 : 0;
+
+  printf("qdr%d: %s: %lu bytes in %lu ms, %lu.%02lu MB/s\n",
+         which, name, bytes, ms, rate / 100, rate % 100);
+}
+
+static int qdr_march_test(int which, u32 flags)
+{
+  u32 m = FPGA_QDR_BASE(which);
+  u32 depth = (flags & 0x20) ? BSP_QDRM_DEPTH : BSP_QDRM_DEPTH_FULL;
+  u32 tests = flags & QDR_MARCH_ALL;
+  ulong start, bytes;
+  u32 d;
+
+  d = fpga_read(m, BSP_QDRM_REG_STAT);
+  if (!(d & BSP_QDRM_PHYRDY)) {
+    sprintf(bit_strerr, "qdr phy not ready");
+    return -1;
+  }
+  if ((d & BSP_QDRM_CALFAIL)) {
+    sprintf(bit_strerr, "qdr phy calibration failed");
+    return -1;
+  }
+
+  if (!tests)
+    tests = QDR_MARCH_ALL;
+
+  if (tests & QDR_MARCH_C) {
+    bytes = 0;
+    start = get_timer(0);
+    if (qdr_march_c(m, depth, &bytes))
+      return -1;
+    qdr_march_report(which, "march c-", bytes, get_timer(start));
+  }
+
+  if (tests & QDR_MARCH_CHECK) {
+    bytes = 0;
+    start = get_timer(0);
+    if (qdr_march_fill(m, depth, QDR_MARCH_CHECK, "checkerboard", &bytes))
+      return -1;
+    qdr_march_report(which, "checkerboard", bytes, get_timer(start));
+  }
+
+  if (tests & QDR_MARCH_ADDR) {
+    bytes = 0;
+    start = get_timer(0);
+    if (qdr_march_fill(m, depth, QDR_MARCH_ADDR, "address in address", &bytes))
+      return -1;
+    qdr_march_report(which, "address in address", bytes, get_timer(start));
+  }
+
+  return 0;
+}
+
 static int qdr_fabric_test(int which)
 {
   sprintf(bit_strerr, "test not implemented");
@@ -530,14 +971,21 @@ static int qdr_fabric_test(int which)
 
 int bit_qdr(int which, int subtest, u32 flags)
 {
+  u8 taps[QDR_CAL_BITS];
+
   switch (subtest){
   case 0:
-    return qdr_phy_cal(which, flags);
+    if (flags & 0x8)
+      return qdr_phy_cal_all(flags);
+    return qdr_phy_cal(which, flags, taps);
     break;
   case 1:
     return qdr_mem_test(which, flags);
     break;
   case 2:
+    return qdr_march_test(which, flags);
+    break;
+  case 3:
     return qdr_fabric_test(which);
     break;
   default:
@@ -1,16 +1,17 @@
 #include <common.h>
 #include <net.h>
+#include <div64.h>
 
 #include <asm/processor.h>
 #include <asm/ppc4xx.h>
 
 #include "../include/bit.h"
 #include "../include/fpga.h"
+#include "../include/fpga_reg.h"
 
 static u16 tge_reg_get_short(int which, u32 reg)
 {
-  u32 offset = CONFIG_SYS_FPGA_BASE + BSP_TGE_OFFSET(which);
-  return *((u16*)(offset + BSP_TGE_REG_OFFSET + reg));
+  return fpga_read16(FPGA_TGE_BASE(which), BSP_TGE_REG_OFFSET + reg);
 }
 
 static int tge_check_phy_status(int which, int delay)
@@ -31,14 +32,210 @@ static int tge_check_phy_status(int which, int delay)
   return 0;
 }
 
+static void tge_reg_set_short(int which, u32 reg, u16 data)
+{
+  fpga_write16(FPGA_TGE_BASE(which), BSP_TGE_REG_OFFSET + reg, data);
+}
+
+/*
+ * Traffic test (subtest 1). Numbered frames are sent from the tx buffer
+ * of one port and checked in the rx buffer of its peer for tgetime ms
+ * (default 1000). The peer is the port itself, looped back externally,
+ * or with flag 0x40 the other port of the cabled pair (which ^ 1). The
+ * frames use the cpu buffers, so the ARP tables, which only steer
+ * fabric traffic, are not involved.
+ *
+ * Frames go out in bursts of tgeburst (default 16): the payload is
+ * written once and only the sequence number is rewritten between sends,
+ * each time the core has released the tx buffer (TXSIZE back at zero)
+ * so a frame still going out is never overwritten. Every frame the cpu rx buffer catches is checked in
+ * full. That buffer holds a single frame, so a burst outruns the cpu and
+ * frames it misses are reported as dropped, not failed; a corrupt or out
+ * of order frame, or a burst of which nothing arrives, fails the test.
+ * The send rate, from the first send of a burst to the release of the
+ * buffer by its last frame, and the rate of the cpu checking frames are
+ * reported apart.
+ */
+#define TGE_FRAME_SIZE   1514
+#define TGE_FRAME_WORDS  ((TGE_FRAME_SIZE + 3) / 4)
+/* valid bytes of the last, possibly partial, word */
+#define TGE_TAIL_MASK    (0xffffffff << (8 * (4 * TGE_FRAME_WORDS - TGE_FRAME_SIZE)))
+#define TGE_PAYLOAD(i)   (((i) << 16) | ((i) ^ 0xffff))
+#define TGE_ETHERTYPE    0x88b5 /* local experimental */
+#define TGE_RX_WAIT      10000  /* polls before the rest of a burst counts as dropped */
+#define TGE_TX_WAIT      10000  /* polls for the core to release the tx buffer */
+#define TGE_LINE_RATE_MB 1250   /* 10 Gb/s in MB/s */
+
+static void tge_build_frame(int which)
+{
+  volatile u32 *tx = (u32 *)(CONFIG_SYS_FPGA_BASE + BSP_TGE_OFFSET(which) + BSP_TGE_TX_OFFSET);
+  int i;
+
+  /* broadcast destination, locally administered source naming the port */
+  tx[0] = 0xffffffff;
+  tx[1] = 0xffff0200;
+  tx[2] = 0x52320000 | which;
+  for (i = 5; i < TGE_FRAME_WORDS; i++)
+    tx[i] = TGE_PAYLOAD(i);
+}
+
+static void tge_set_seq(int which, u32 seq)
+{
+  volatile u32 *tx = (u32 *)(CONFIG_SYS_FPGA_BASE + BSP_TGE_OFFSET(which) + BSP_TGE_TX_OFFSET);
+
+  tx[3] = (TGE_ETHERTYPE << 16) | (seq >> 16);
+  tx[4] = (seq << 16) | (which << 8);
+}
+
+/* check the frame in the rx buffer of peer and return its sequence number */
+static int tge_check_frame(int peer, int which, u32 *seq)
+{
+  volatile u32 *rx = (u32 *)(CONFIG_SYS_FPGA_BASE + BSP_TGE_OFFSET(peer) + BSP_TGE_RX_OFFSET);
+  int i;
+
+  if (rx[2] != (0x52320000 | which) ||
+      (rx[3] >> 16) != TGE_ETHERTYPE ||
+      (rx[4] & 0xffff) != (which << 8))
+    return -1;
+  for (i = 5; i < TGE_FRAME_WORDS - 1; i++) {
+    if (rx[i] != TGE_PAYLOAD(i))
+      return -1;
+  }
+  if ((rx[i] ^ TGE_PAYLOAD(i)) & TGE_TAIL_MASK)
+    return -1;
+
+  *seq = (rx[3] << 16) | (rx[4] >> 16);
+  return 0;
+}
+
+/* the core clears TXSIZE once the frame has left the tx buffer */
+static int tge_tx_wait(int which)
+{
+  int i;
+
+  for (i = 0; i < TGE_TX_WAIT; i++) {
+    if (!tge_reg_get_short(which, BSP_TGE_REG_TXSIZE))
+      return 0;
+  }
+  sprintf(bit_strerr, "tx buffer of tge%d not released", which);
+  return -1;
+}
+
+static ulong tge_ticks_to_us(unsigned long long ticks)
+{
+  return lldiv(ticks, get_tbclk() / 1000000);
+}
+
+/* hundredths of a percent of line rate */
+static ulong tge_rate(unsigned long long bytes, ulong us)
+{
+  if (!us)
+    return 0;
+  return lldiv(lldiv(bytes * 10000, TGE_LINE_RATE_MB), us);
+}
+
+static int tge_traffic_test(int which, u32 flags)
+{
+  int peer = (flags & 0x40) ? which ^ 1 : which;
+  ulong duration, burst, start, ms, txus, rxus, rate;
+  ulong sent = 0, frames = 0, errors = 0, lost = 0, bursts = 0;
+  unsigned long long t, txticks = 0, rxticks = 0;
+  u32 seq = 0, next, got;
+  u16 rxsize;
+  char *s;
+  int b, i;
+
+  if (tge_check_phy_status(which, 1000) || (peer != which && tge_check_phy_status(peer, 1000)))
+    return -1;
+
+  s = getenv("tgetime");
+  duration = s ? simple_strtoul(s, NULL, 10) : 1000;
+  s = getenv("tgeburst");
+  burst = s ? simple_strtoul(s, NULL, 10) : 16;
+  if (!burst)
+    burst = 1;
+
+  /* drop anything already queued */
+  tge_reg_set_short(peer, BSP_TGE_REG_RXSIZE, 0);
+  if (tge_tx_wait(which))
+    return -1;
+  tge_build_frame(which);
+
+  start = get_timer(0);
+  while ((ms = get_timer(start)) < duration) {
+    t = get_ticks();
+    for (b = 0; b < burst; b++) {
+      if (b && tge_tx_wait(which))
+        return -1;
+      tge_set_seq(which, seq + b);
+      tge_reg_set_short(which, BSP_TGE_REG_TXSIZE, TGE_FRAME_SIZE);
+    }
+    if (tge_tx_wait(which))
+      return -1;
+    txticks += get_ticks() - t;
+    sent += burst;
+    bursts++;
+
+    /* take what arrives, up to the last frame of the burst */
+    t = get_ticks();
+    next = seq;
+    while (next != seq + burst) {
+      for (i = 0; i < TGE_RX_WAIT; i++) {
+        if ((rxsize = tge_reg_get_short(peer, BSP_TGE_REG_RXSIZE)) != 0)
+          break;
+      }
+      if (i == TGE_RX_WAIT)
+        break;
+
+      if (rxsize != TGE_FRAME_SIZE || tge_check_frame(peer, which, &got) ||
+          got < next || got >= seq + burst) {
+        errors++;
+      } else {
+        frames++;
+        next = got + 1;
+      }
+      tge_reg_set_short(peer, BSP_TGE_REG_RXSIZE, 0);
+    }
+    rxticks += get_ticks() - t;
+
+    if (next == seq)
+      lost++;
+    seq += burst;
+
+    if (bit_abort())
+      return -1;
+  }
+
+  txus = tge_ticks_to_us(txticks);
+  rxus = tge_ticks_to_us(rxticks);
+
+  rate = tge_rate((unsigned long long)sent * TGE_FRAME_SIZE, txus);
+  printf("tge%d -> tge%d: %lu frames sent in %lu bursts, %lu us to send, %lu.%02lu%% of line rate\n",
+         which, peer, sent, bursts, txus, rate / 100, rate % 100);
+  rate = tge_rate((unsigned long long)frames * TGE_FRAME_SIZE, rxus);
+  printf("tge%d -> tge%d: %lu frames checked, %lu corrupt, %lu dropped, %lu bursts lost, "
+         "%lu us polling, %lu.%02lu%% of line rate\n",
+         which, peer, frames, errors, sent - frames - errors, lost, rxus,
+         rate / 100, rate % 100);
+
+  if (!frames) {
+    sprintf(bit_strerr, "no frames received on tge%d", peer);
+    return -1;
+  }
+  if (errors || lost) {
+    sprintf(bit_strerr, "%lu corrupt frames and %lu lost of %lu bursts", errors, lost, bursts);
+    return -1;
+  }
+  return 0;
+}
+
 int bit_tge(int which, int subtest, u32 flags) {
   switch (subtest){
   case 0: 
     return tge_check_phy_status(which, 1000000);
     break;
   case 1: 
-    sprintf(bit_strerr,"not implemented");
-    return -1;
+    return tge_traffic_test(which, flags);
     break;
   case 2: 
     sprintf(bit_strerr,"not implemented");
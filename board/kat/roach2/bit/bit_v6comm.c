@@ -10,15 +10,26 @@
 /************************** V6 Comms BIT *******************************/
 
 #define TEST_LEN 4
+
+/*
+ * The scratch registers are not only test space: r2smap keeps the crc
+ * of the loaded image in one of them. Their contents are saved and put
+ * back around the test, and the restore is checked so a failure to do
+ * so is reported rather than found later as a needless reprogram.
+ */
 int v6comm_scratchtest(u32 flags)
 {
   u32 offset = CONFIG_SYS_FPGA_BASE;
   u32 test_data[TEST_LEN] = {0x55555555, 0xaaaaaaaa, 0x01234567, 0x89abcdef};
   u16 half_test_data[TEST_LEN*2] = {0x8081, 0x9293, 0xa4a5, 0xb6b7,
                                     0xc0c1, 0xd2d3, 0xe4e5, 0xf6f7};
+  u32 saved[TEST_LEN];
   u32 val;
   u16 halfval;
-  int i;
+  int i, ret = 0;
+
+  for (i = 0; i < TEST_LEN; i++)
+    saved[i] = *((volatile u32 *)(offset + BSP_REG_SCRATCH(i)));
 
   for (i = 0; i < TEST_LEN; i++) {
     /*printf("Writing %x to %8x\n", test_data[i], (offset + BSP_REG_SCRATCH(i)));*/
@@ -30,7 +41,8 @@ int v6comm_scratchtest(u32 flags)
     if (val != test_data[i]) {
       sprintf(bit_strerr, "scratchpad readback failure at %8x - got %x, expected %x",
                                 offset + BSP_REG_SCRATCH(i), val, test_data[i]);
-      return -1;
+      ret = -1;
+      goto restore;
     }
   }
 
@@ -43,10 +55,24 @@ int v6comm_scratchtest(u32 flags)
     if (halfval != half_test_data[i]) {
       sprintf(bit_strerr, "scratchpad readback failure at %8x - got %x, expected %x",
                               offset + BSP_REG_SCRATCH(0) + i*2, halfval, half_test_data[i]);
-      return -1;
+      ret = -1;
+      goto restore;
     }
   }
-  return 0;
+
+restore:
+  for (i = 0; i < TEST_LEN; i++)
+    *((volatile u32 *)(offset + BSP_REG_SCRATCH(i))) = saved[i];
+
+  for (i = 0; i < TEST_LEN && !ret; i++) {
+    val = *((volatile u32 *)(offset + BSP_REG_SCRATCH(i)));
+    if (val != saved[i]) {
+      sprintf(bit_strerr, "scratchpad restore failure at %8x - got %x, expected %x",
+                              offset + BSP_REG_SCRATCH(i), val, saved[i]);
+      ret = -1;
+    }
+  }
+  return ret;
 }
 
 int bit_v6comm(int which, int subtest, u32 flags)
@@ -6,6 +6,7 @@
 
 #include "../include/bit.h"
 #include "../include/fpga.h"
+#include "../include/fpga_reg.h"
 
 static u8 local_mac[6] = {0x01, 0x23, 0x45, 0x67, 0x89, 0xab};
 static u8 remote_mac[6] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
@@ -38,14 +39,12 @@ IPaddr_t v6gbe_server_ip(void)
 
 void v6gbe_reg_set_short(u32 reg, u16 data)
 {
-  u32 offset = CONFIG_SYS_FPGA_BASE + BSP_GBE_OFFSET;
-  *((u16*)(offset + BSP_GBE_REG_OFFSET + reg)) = data;
+  fpga_write16(FPGA_GBE_BASE, BSP_GBE_REG_OFFSET + reg, data);
 }
 
 u16 v6gbe_reg_get_short(u32 reg)
 {
-  u32 offset = CONFIG_SYS_FPGA_BASE + BSP_GBE_OFFSET;
-  return *((u16*)(offset + BSP_GBE_REG_OFFSET + reg));
+  return fpga_read16(FPGA_GBE_BASE, BSP_GBE_REG_OFFSET + reg);
 }
 
 int v6gbe_sendpacket(u8* data, int size)
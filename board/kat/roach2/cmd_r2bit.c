@@ -26,6 +26,8 @@
 #include "include/fpga.h"
 #include "include/cpld.h"
 #include "include/bit.h"
+#include "include/fpga_reg.h"
+#include "include/sensors.h"
 
 #ifdef CONFIG_CMD_R2BIT
 
@@ -42,27 +44,40 @@ extern int bit_ddr3(int which, int subtest, u32 flags);
 #define BIT_TESTS 6
 /* Removed non-implemented tests */
 /* const char* tge_subtests[2] = {"phy status", "fabric counter test"}; */
-const char* tge_subtests[1] = {"phy status"};
+const char* tge_subtests[2] = {"phy status", "traffic"};
 /* const char* v6gbe_subtests[3] = {"sgmii status", "ping", "phy status"}; */
 const char* v6gbe_subtests[2] = {"sgmii status", "ping"}; 
 const char* v6comm_subtests[2] = {"version check", "scratchpad access"}; 
 const char* zdok_subtests[1] = {"basic connectivity"}; 
 /*const char* qdr_subtests[3] = {"calibration", "ppc access", "fabric"};
 const char* ddr3_subtests[3] = {"calibration", "ppc access", "fabric"};*/
-const char* qdr_subtests[2] = {"calibration", "ppc access"}; 
-const char* ddr3_subtests[2] = {"calibration", "ppc access"};
+const char* qdr_subtests[3] = {"calibration", "ppc access", "march"};
+const char* ddr3_subtests[3] = {"calibration", "ppc access", "full coverage"};
 
 static struct bit_mapping bit_list[BIT_TESTS] = {
-  {&bit_tge, "tge", 8, 1, tge_subtests},
-  {&bit_v6gbe, "v6gbe", 1, 2, v6gbe_subtests},
-  {&bit_v6comm, "v6comm", 1, 2, v6comm_subtests},
-  {&bit_zdok, "zdok", 2, 1, zdok_subtests},
-  {&bit_qdr, "qdr", 4, 2, qdr_subtests},
-  {&bit_ddr3, "ddr3", 1, 2, ddr3_subtests},
+  {&bit_tge, "tge", 8, 2, tge_subtests, 2},
+  {&bit_v6gbe, "v6gbe", 1, 2, v6gbe_subtests, 2},
+  {&bit_v6comm, "v6comm", 1, 2, v6comm_subtests, 2},
+  {&bit_zdok, "zdok", 2, 1, zdok_subtests, 1},
+  {&bit_qdr, "qdr", 4, 3, qdr_subtests, 2},
+  {&bit_ddr3, "ddr3", 1, 3, ddr3_subtests, 2},
 };
 
 char bit_strerr[256];
 
+int bit_abort(void)
+{
+  if (ctrlc()) {
+    sprintf(bit_strerr, "interrupted");
+    return 1;
+  }
+  if (thermal_poll()) {
+    sprintf(bit_strerr, "over temperature");
+    return 1;
+  }
+  return 0;
+}
+
 void list_bits(void)
 {
   int i, j;
@@ -75,10 +90,18 @@ void list_bits(void)
   }
 }
 
-static int run_bit(struct bit_mapping *bitm, int which, int subtest, u32 flags)
+static int run_bit(struct bit_mapping *bitm, int which, int subtest, u32 flags, ulong *elapsed)
 {
   int ret;
+  ulong start;
+
+  bit_strerr[0] = '\0';
+  fpga_reg_stats_reset();
+  start = get_timer(0);
   ret = (*bitm->test)(which, subtest, flags);
+  if (elapsed)
+    *elapsed = get_timer(start);
+
   printf("(test: %s", bitm->name);
   if (bitm->devices != 1)
     printf("[%d]", which);
@@ -88,9 +111,91 @@ static int run_bit(struct bit_mapping *bitm, int which, int subtest, u32 flags)
     printf("PASSED\n");
   else
     printf("FAILED: %s\n", bit_strerr);
+
+  if (flags & 0x1)
+    printf("fpga register traffic: %lu reads, %lu writes, %lu coalesced\n",
+           fpga_reg_stats.reads, fpga_reg_stats.writes, fpga_reg_stats.coalesced);
   return ret;
 }
 
+/*
+ * Batch mode: every subtest of every device is run and the outcome
+ * published for rack tooling. The full-depth memory soaks (qdr march,
+ * ddr3 full coverage) take minutes and are left out unless BIT_FLAG_LONG
+ * is given. bit_summary holds one compact
+ * <test><which>.<subtest>:<P|F> token per run, bit_passed/bit_failed/
+ * bit_elapsed the totals. The full report, one line per run of the form
+ * "<test> <which> <subtest> <PASS|FAIL> <ms> <reads> <writes> [error]",
+ * with the fpga register accesses made by the test, is left in memory at
+ * bit_report (bit_reportlen bytes).
+ */
+#define BIT_SUMMARY_SIZE 1024
+#define BIT_REPORT_SIZE  8192
+/* longest report line: name, numbers and a full bit_strerr */
+#define BIT_REPORT_LINE  (64 + sizeof(bit_strerr))
+
+static char bit_summary[BIT_SUMMARY_SIZE];
+static char bit_report[BIT_REPORT_SIZE];
+
+static int run_all_bits(u32 flags)
+{
+  struct bit_mapping *bitm;
+  int i, which, subtest, subtests, ret;
+  int passed = 0, failed = 0;
+  int slen = 0, rlen = 0;
+  ulong start, elapsed;
+  char buf[16];
+
+  start = get_timer(0);
+  bit_summary[0] = '\0';
+
+  for (i = 0; i < BIT_TESTS; i++) {
+    bitm = &bit_list[i];
+    subtests = (flags & BIT_FLAG_LONG) ? bitm->subtests : bitm->batch_subtests;
+    for (which = 0; which < bitm->devices; which++) {
+      for (subtest = 0; subtest < subtests; subtest++) {
+        if (bit_abort()) {
+          printf("info: batch stopped, %s\n", bit_strerr);
+          goto out;
+        }
+
+        ret = run_bit(bitm, which, subtest, flags, &elapsed);
+        if (ret)
+          failed++;
+        else
+          passed++;
+
+        if (slen + 32 < BIT_SUMMARY_SIZE)
+          slen += sprintf(bit_summary + slen, "%s%s%d.%d:%c", slen ? " " : "",
+                          bitm->name, which, subtest, ret ? 'F' : 'P');
+        if (rlen + BIT_REPORT_LINE < BIT_REPORT_SIZE)
+          rlen += sprintf(bit_report + rlen, "%s %d %d %s %lu %lu %lu %s\n", bitm->name,
+                          which, subtest, ret ? "FAIL" : "PASS", elapsed,
+                          fpga_reg_stats.reads, fpga_reg_stats.writes,
+                          ret ? bit_strerr : "");
+      }
+    }
+  }
+
+out:
+  elapsed = get_timer(start);
+
+  setenv("bit_summary", bit_summary);
+  sprintf(buf, "%d", passed);
+  setenv("bit_passed", buf);
+  sprintf(buf, "%d", failed);
+  setenv("bit_failed", buf);
+  sprintf(buf, "%lu", elapsed);
+  setenv("bit_elapsed", buf);
+  sprintf(buf, "%lx", (ulong)bit_report);
+  setenv("bit_report", buf);
+  sprintf(buf, "%x", rlen);
+  setenv("bit_reportlen", buf);
+
+  printf("info: %d passed, %d failed in %lu ms\n", passed, failed, elapsed);
+  return failed ? -1 : 0;
+}
+
 int do_roach2_test(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
   int i, index=-1;
@@ -103,6 +208,9 @@ int do_roach2_test(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
     return 0;
   }
 
+  if (!strcmp(argv[1], "all"))
+    return run_all_bits(argc > 2 ? simple_strtoul(argv[2], NULL, 16) : 0);
+
   for (i = 0; i < BIT_TESTS; i++) {
     if (!strcmp(argv[1], bit_list[i].name)){
       index = i;
@@ -136,10 +244,10 @@ int do_roach2_test(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 
   if (arg_subtest < 0) {
     for (i=0; i < bit_list[index].subtests; i++) {
-      ret |= run_bit(&bit_list[index], arg_which, i, arg_flags);
+      ret |= run_bit(&bit_list[index], arg_which, i, arg_flags, NULL);
     }
   } else {
-    ret = run_bit(&bit_list[index], arg_which, arg_subtest, arg_flags);
+    ret = run_bit(&bit_list[index], arg_which, arg_subtest, arg_flags, NULL);
   }
 
   return ret;
@@ -150,6 +258,14 @@ U_BOOT_CMD(
 	r2bit,	5,	1,	do_roach2_test,
 	"run a roach2 built-in tests",
 	"<test> [which] [subtest] [flags] - run 'subtest' of 'test' on 'which' device with 'flags'\n"
-  "      list - list the availiable tests and subtests"
+  "      list - list the availiable tests and subtests\n"
+  "r2bit all [flags] - run every test, results in bit_summary and the bit_report buffer\n"
+  "flags, shared by all tests, so each bit has one meaning:\n"
+  "      1 verbose, 2 report every error and carry on\n"
+  "      4 qdr: full calibration sweep, 8 qdr: calibrate all at once,\n"
+  "      10 qdr: also time the sequential sweep, 20 qdr: short march\n"
+  "      40 tge: traffic to the cabled peer port (which ^ 1)\n"
+  "      100/200/400 qdr: march c-/checkerboard/address patterns\n"
+  "      1000 all: add the full-depth qdr march and ddr3 soak"
 );
 #endif /* CONFIG_CMD_R2BIT */
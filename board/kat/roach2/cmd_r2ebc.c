@@ -0,0 +1,132 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+#include <common.h>
+#include <command.h>
+
+#include <asm/processor.h>
+#include <asm/ppc4xx.h>
+#include <asm/ppc4xx-ebc.h>
+
+#include "include/fpga.h"
+#include "include/smap.h"
+#include "include/bit.h"
+
+#ifdef CONFIG_CMD_R2EBC
+
+/*
+ * Candidate fpga window access parameters, fastest first, ending with
+ * the compiled-in default so the sweep always covers a setting known
+ * to work. The selectmap bank is not swept: its default already runs
+ * without wait states, so there is nothing faster to find.
+ */
+static const u32 ebc_cs1_ap[] = {
+  EBC_AP_TWT(0) | EBC_AP_OEN(0) | EBC_AP_TH(0) | EBC_AP_RE | EBC_AP_SOR,
+  EBC_AP_TWT(1) | EBC_AP_OEN(0) | EBC_AP_TH(0) | EBC_AP_RE | EBC_AP_SOR,
+  EBC_AP_TWT(1) | EBC_AP_OEN(1) | EBC_AP_TH(0) | EBC_AP_RE | EBC_AP_SOR,
+  EBC_AP_TWT(1) | EBC_AP_OEN(1) | EBC_AP_TH(1) | EBC_AP_RE | EBC_AP_SOR,
+  CONFIG_SYS_EBC_PB1AP,
+};
+
+/* scratchpad passes run against each fpga window setting */
+#define EBC_TUNE_RUNS 256
+
+static int ebc_check_fpga(void)
+{
+  int i;
+
+  if (*((volatile u32 *)(CONFIG_SYS_FPGA_BASE + BSP_REG_BOARDID)) != BSP_BOARDID) {
+    sprintf(bit_strerr, "board ID check failed");
+    return -1;
+  }
+  for (i = 0; i < EBC_TUNE_RUNS; i++) {
+    if (v6comm_scratchtest(0))
+      return -1;
+  }
+  return 0;
+}
+
+static int ebc_tune_cs1(void)
+{
+  ulong start;
+  int i;
+
+  for (i = 0; i < ARRAY_SIZE(ebc_cs1_ap); i++) {
+    mtebc(PB1AP, ebc_cs1_ap[i]);
+    printf("ebc: cs1 [fpga]  ap=0x%08x: ", ebc_cs1_ap[i]);
+
+    start = get_timer(0);
+    if (ebc_check_fpga()) {
+      printf("%s\n", bit_strerr);
+      continue;
+    }
+    printf("%d scratchpad passes in %lu ms, ok\n", EBC_TUNE_RUNS, get_timer(start));
+    return i;
+  }
+  return -1;
+}
+
+static int do_roach2_ebc(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+  char buf[16];
+  int cs1;
+
+  if (argc < 2) {
+    printf ("Usage:\n%s\n", cmdtp->usage);
+    return 1;
+  }
+
+  if (!strcmp(argv[1], "clear")) {
+    setenv("ebc_pb1ap", NULL);
+    mtebc(PB1AP, CONFIG_SYS_EBC_PB1AP);
+    printf("info: restored default fpga timing\n");
+    return 0;
+  }
+
+  if (strcmp(argv[1], "tune") || argc < 3) {
+    printf ("Usage:\n%s\n", cmdtp->usage);
+    return 1;
+  }
+
+  /* load the BSP image through the known good fpga window */
+  mtebc(PB1AP, CONFIG_SYS_EBC_PB1AP);
+  if (smap_program(simple_strtoul(argv[2], NULL, 16), 0, SMAP_FLAG_FORCE)) {
+    printf("error: fpga configuration failed\n");
+    return -1;
+  }
+
+  if ((cs1 = ebc_tune_cs1()) < 0) {
+    mtebc(PB1AP, CONFIG_SYS_EBC_PB1AP);
+    printf("error: no stable fpga timing found\n");
+    return -1;
+  }
+
+  sprintf(buf, "%08x", ebc_cs1_ap[cs1]);
+  setenv("ebc_pb1ap", buf);
+
+  printf("info: cs1 ap=0x%08x; saveenv to apply at boot\n", ebc_cs1_ap[cs1]);
+  return 0;
+}
+
+U_BOOT_CMD(
+	r2ebc,	3,	0,	do_roach2_ebc,
+	"tune fpga bus timing",
+	"tune <address> - program the bitstream at address and find the\n"
+	"    fastest stable cs1 timing against it\n"
+	"r2ebc clear - drop tuned timing and restore the default\n"
+);
+#endif /* CONFIG_CMD_R2EBC */
@@ -25,6 +25,7 @@
 #include <i2c.h>
 
 #include "include/sensors.h"
+#include "include/deferred.h"
 
 #ifdef CONFIG_CMD_R2SENSORS
 
@@ -32,101 +33,97 @@ struct max16071_current cmon_defs[CMON_COUNT] = CURRENT_DEFS;
 struct max16071_voltage vmon_defs[VMON_COUNT] = VOLTAGE_DEFS;
 struct max16071_pgood pgood_defs[PGOOD_COUNT] = PGOOD_DEFS;
 
-static int sensor_get_reg(u8 addr, u8 reg)
+static int max16071_get_adcval(struct r2_sensor_snapshot *snap, int which, u8 chan)
 {
-  uchar buffer[1];
-  if (i2c_read(addr, reg, 1, buffer, 1) != 0) {
-    printf("cannot read from i2c device: %02x\n", addr);
+  if (!(snap->valid & (which == VMON ? SNAP_VALID_VMON : SNAP_VALID_CMON)))
     return -1;
-  }
-  return buffer[0];
+  return snap->max16071[which][MAX16071_REG_ADCVAL_MSB(chan)];
 }
 
-static int max16071_get_adcval(int which, u8 chan)
+static int max16071_get_cmon(struct r2_sensor_snapshot *snap, int which)
 {
-  int addr = which == VMON ? R2_VMON_IIC_ADDR : R2_CMON_IIC_ADDR;
-  int val;
-  val = sensor_get_reg(addr, MAX16071_REG_ADCVAL_MSB(chan));
-  if (val < 0) {
+  if (!(snap->valid & (which == VMON ? SNAP_VALID_VMON : SNAP_VALID_CMON)))
     return -1;
-  }
-  return val & 0xff;
+  return snap->max16071[which][MAX16071_REG_CMON];
+}
+
+static int max16071_get_gpioi(struct r2_sensor_snapshot *snap, int which)
+{
+  if (!(snap->valid & (which == VMON ? SNAP_VALID_VMON : SNAP_VALID_CMON)))
+    return -1;
+  return snap->max16071[which][MAX16071_REG_GPIOI];
 }
 
-static int max16071_get_cmon(int which)
+static int vmon_get_mv(struct r2_sensor_snapshot *snap, int i)
 {
-  int addr = which == VMON ? R2_VMON_IIC_ADDR : R2_CMON_IIC_ADDR;
-  int val;
-  val = sensor_get_reg(addr, MAX16071_REG_CMON);
-  if (val < 0) {
+  int value, voltage;
+
+  value = max16071_get_adcval(snap, vmon_defs[i].device, vmon_defs[i].src);
+  if (value < 0)
     return -1;
+  //voltage = (value * VMON_FULLSCALE * vmon_defs[i].gain) / (((2^8)-1) * 1000);
+  voltage = (value * VMON_FULLSCALE) / ((256)-1);
+  return (voltage * vmon_defs[i].gain) / 1000;
+}
+
+static int cmon_get_ma(struct r2_sensor_snapshot *snap, int i)
+{
+  int value, voltage;
+
+  if (cmon_defs[i].src == CMON_SOURCE_EXTERNAL) {
+    value = max16071_get_cmon(snap, cmon_defs[i].device);
+    if (value < 0)
+      return -1;
+    voltage = (value * CMON_EXTERNAL_FULLSCALE)/255;
+  } else {
+    value = max16071_get_adcval(snap, cmon_defs[i].device, cmon_defs[i].src);
+    if (value < 0)
+      return -1;
+    voltage = (value * CMON_FULLSCALE)/255;
   }
-  return val & 0xff;
+  return (voltage * cmon_defs[i].conductance)/(cmon_defs[i].gain);
 }
 
-static void vmon_print_vals(void)
+static void vmon_print_vals(struct r2_sensor_snapshot *snap)
 {
   int i;
-  int value, voltage;
+  int voltage;
   //printf("Supply voltages:\n");
   for (i=0; i < VMON_COUNT; i++){
-    value = max16071_get_adcval(vmon_defs[i].device, vmon_defs[i].src);
-    if (value < 0) {
+    voltage = vmon_get_mv(snap, i);
+    if (voltage < 0) {
       printf("error reading supply %s\n", vmon_defs[i].name);
     } else {
-      //voltage = (value * VMON_FULLSCALE * vmon_defs[i].gain) / (((2^8)-1) * 1000);
-      voltage = (value * VMON_FULLSCALE) / ((256)-1);
-      voltage = (voltage * vmon_defs[i].gain) / 1000;
       printf("Vsupply     %s: %6d mV\n", vmon_defs[i].name, voltage);
     }
   }
 }
 
-static void cmon_print_vals(void)
+static void cmon_print_vals(struct r2_sensor_snapshot *snap)
 {
   int i;
-  int value, current, voltage;
+  int current;
   //printf("Supply currents:\n");
   for (i=0; i < CMON_COUNT; i++){
-    if (cmon_defs[i].src == CMON_SOURCE_EXTERNAL) {
-      value = max16071_get_cmon(cmon_defs[i].device);
-      if (value < 0) {
-        printf("error reading supply %s\n", cmon_defs[i].name);
-        continue;
-      } else {
-        voltage = (value * CMON_EXTERNAL_FULLSCALE)/255;
-      }
-    } else {
-      value = max16071_get_adcval(cmon_defs[i].device, cmon_defs[i].src);
-      if (value < 0) {
-        printf("error reading supply %s\n", cmon_defs[i].name);
-        continue;
-      } else {
-        voltage = (value * CMON_FULLSCALE)/255;
-      }
+    current = cmon_get_ma(snap, i);
+    if (current < 0) {
+      printf("error reading supply %s\n", cmon_defs[i].name);
+      continue;
     }
-    current = (voltage * cmon_defs[i].conductance)/(cmon_defs[i].gain);
-    //printf("supply    %s: %d mA [%d, %d, %x]\n", cmon_defs[i].name, current, voltage*1000/cmon_defs[i].gain, voltage, value);
     printf("Isupply        %s:  %5d mA\n", cmon_defs[i].name, current);
   }
 }
 
-static void pgood_print_vals(void)
+static void pgood_print_vals(struct r2_sensor_snapshot *snap)
 {
   int i;
   int value;
-  u8 addr;
   //printf("Supply power-goods:\n");
 
   for (i=0; i < PGOOD_COUNT; i++){
-    if (pgood_defs[i].device == VMON)
-      addr = R2_VMON_IIC_ADDR;
-    else
-      addr = R2_CMON_IIC_ADDR;
-
-    value = sensor_get_reg(addr, MAX16071_REG_GPIOI);
+    value = max16071_get_gpioi(snap, pgood_defs[i].device);
     if (value < 0) {
-      printf("error reading supply %s\n", vmon_defs[i].name);
+      printf("error reading supply %s\n", pgood_defs[i].name);
     } else {
       value &= (1 << pgood_defs[i].src);
       printf("PGsupply   %s: ", pgood_defs[i].name);
@@ -139,107 +136,143 @@ static void pgood_print_vals(void)
   }
 }
 
-/* vvvvv TODO: requires cleanup vvvvv */
+static char *ambient_names[SNAP_AMBIENT_COUNT] = {"  inlet", " outlet"};
+static char *fan_names[SNAP_FAN_COUNT] = {" FPGA", " CHS0", " CHS1", " CHS2"};
 
-void ambient_print_vals(u8 addr, char *descrip)
+void ambient_print_vals(struct r2_sensor_snapshot *snap)
 {
-  uchar buffer[2];
+  int i;
 
-  if (i2c_read(addr, R2_SENSOR_AD7414_TV, 1, buffer, 2) != 0) {
-    printf("error getting ambient[%02x]\n", addr);
-    return;
+  for (i = 0; i < SNAP_AMBIENT_COUNT; i++) {
+    if (!(snap->valid & (SNAP_VALID_AMBIENT0 << i))) {
+      printf("error getting ambient[%02x]\n", snap_ambient_addr[i]);
+      continue;
+    }
+    printf("Tambient   %s:   %4d dC %s\n", ambient_names[i], snap->ambient[i][0],
+                      snap->ambient[i][1] & 0x18 ? "[ALARM]" : "");
   }
-
-  printf("Tambient   %s:   %4d dC %s\n", descrip, buffer[0],
-                    buffer[1] & 0x18 ? "[ALARM]" : "");
 }
 
-void remote_print_vals(void)
+void remote_print_vals(struct r2_sensor_snapshot *snap)
 {
-  int value;
-  u8 addr = R2_SENSOR_MAX1805_U22_I2C_ADDR;
-
-  value = sensor_get_reg(addr, R2_SENSOR_MAX1805_TEMP_DX1);
-  if (value < 0){
+  if (!(snap->valid & SNAP_VALID_REMOTE)) {
     printf("error getting remote temperature\n");
     return;
   }
-  printf("Tremote    PowerPC:   %4d dC", value);
-  value = sensor_get_reg(addr, R2_SENSOR_MAX1805_TEMP_RS2);
-  printf("%s\n", value & 0xC0 ? "[ALARM]" : "");
-
-  value = sensor_get_reg(addr, R2_SENSOR_MAX1805_TEMP_DX2);
-  if (value < 0){
-    printf("error getting remote temperature\n");
-    return;
-  }
-  printf("Tremote    Virtex6:   %4d dC", value);
-  value = sensor_get_reg(addr, R2_SENSOR_MAX1805_TEMP_RS2);
-  printf("%s\n", value & 0x30 ? "[ALARM]" : "");
+  printf("Tremote    PowerPC:   %4d dC", snap->remote[0]);
+  printf("%s\n", snap->remote_status & 0xC0 ? "[ALARM]" : "");
+  printf("Tremote    Virtex6:   %4d dC", snap->remote[1]);
+  printf("%s\n", snap->remote_status & 0x30 ? "[ALARM]" : "");
 }
 
-void fans_print_vals(u8 addr, char* descrip)
+void fans_print_vals(struct r2_sensor_snapshot *snap)
 {
-  int value;
+  int i;
 
-  value = sensor_get_reg(addr, R2_SENSOR_MAX6650_TACH0);
-  if (value < 0){
-    printf("error getting fan speed\n");
-    return;
-  }
-  printf("Sfan         %s:   %4d RPM", descrip, value*30);
-  value = sensor_get_reg(addr, R2_SENSOR_MAX6650_ALARMST);
-  if (value < 0){
-    printf("error getting fan speed\n");
-    return;
+  for (i = 0; i < SNAP_FAN_COUNT; i++) {
+    if (!(snap->valid & (SNAP_VALID_FAN0 << i))) {
+      printf("error getting fan speed\n");
+      continue;
+    }
+    printf("Sfan         %s:   %4d RPM", fan_names[i], snap->fan_tach[i]*30);
+    printf("%s\n", snap->fan_alarm[i] & 0x03 ? "[ALARM]" : "");
   }
-  printf("%s\n", value & 0x03 ? "[ALARM]" : "");
+}
+
+static void print_roach2_sensor_info(struct r2_sensor_snapshot *snap)
+{
+  vmon_print_vals(snap);
+  cmon_print_vals(snap);
+  pgood_print_vals(snap);
+  ambient_print_vals(snap);
+  remote_print_vals(snap);
+  fans_print_vals(snap);
 }
 
 int dump_roach2_sensor_info(void)
 {
-  vmon_print_vals();
-  cmon_print_vals();
-  pgood_print_vals();
-  ambient_print_vals(R2_SENSOR_AD7414_U15_I2C_ADDR, "  inlet");
-  ambient_print_vals(R2_SENSOR_AD7414_U18_I2C_ADDR, " outlet");
-  remote_print_vals();
-  fans_print_vals(R2_SENSOR_MAX6650_U13_I2C_ADDR, " FPGA");
-  fans_print_vals(R2_SENSOR_MAX6650_U17_I2C_ADDR, " CHS0");
-  fans_print_vals(R2_SENSOR_MAX6650_U21_I2C_ADDR, " CHS1");
-  fans_print_vals(R2_SENSOR_MAX6650_U26_I2C_ADDR, " CHS2");
-  
+  sensors_snapshot(&sensor_snap);
+  print_roach2_sensor_info(&sensor_snap);
+  return 0;
+}
+
+/*
+ * Export the last snapshot as space separated lists for scripts:
+ * sens_mv, sens_ma, sens_temp (inlet outlet ppc fpga, dC), sens_rpm.
+ * Values that could not be read are given as -1.
+ */
+static int export_roach2_sensor_info(struct r2_sensor_snapshot *snap)
+{
+  char buf[128];
+  char *p;
+  int i;
+
+  for (p = buf, i = 0; i < VMON_COUNT; i++)
+    p += sprintf(p, "%s%d", i ? " " : "", vmon_get_mv(snap, i));
+  setenv("sens_mv", buf);
+
+  for (p = buf, i = 0; i < CMON_COUNT; i++)
+    p += sprintf(p, "%s%d", i ? " " : "", cmon_get_ma(snap, i));
+  setenv("sens_ma", buf);
+
+  for (p = buf, i = 0; i < SNAP_AMBIENT_COUNT; i++)
+    p += sprintf(p, "%d ", snap->valid & (SNAP_VALID_AMBIENT0 << i) ?
+                           snap->ambient[i][0] : -1);
+  if (snap->valid & SNAP_VALID_REMOTE)
+    sprintf(p, "%d %d", snap->remote[0], snap->remote[1]);
+  else
+    sprintf(p, "-1 -1");
+  setenv("sens_temp", buf);
+
+  for (p = buf, i = 0; i < SNAP_FAN_COUNT; i++)
+    p += sprintf(p, "%s%d", i ? " " : "", snap->valid & (SNAP_VALID_FAN0 << i) ?
+                                         snap->fan_tach[i]*30 : -1);
+  setenv("sens_rpm", buf);
+
   return 0;
 }
 
 static int do_roach2_sensors(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
-  /*int i;
-  printf("Arg count: %d\n",argc);
-
-  for (i=0; i<argc; i++)
-    printf("%d:%s\n",i,argv[i]);
-*/
-  
-  switch (argc) { 
-    case 2:
-      if (strcmp(argv[1], "dump") == 0){
-        return dump_roach2_sensor_info();
-      }
-    case 1:
-      return dump_roach2_sensor_info();
-      break;
-    default:
+  int fail;
+
+  if (argc > 2)
+    return 1;
+
+  r2_init_need(R2_INIT_SENSORS);
+
+  if (argc == 2 && strcmp(argv[1], "cached") == 0) {
+    if (sensor_snap.stamp == 0 && sensor_snap.valid == 0) {
+      printf("error: no snapshot taken yet\n");
       return 1;
+    }
+    printf("Snapshot age: %lu ms\n", get_timer(sensor_snap.stamp));
+    print_roach2_sensor_info(&sensor_snap);
+    return 0;
   }
 
-  return 1;
+  fail = sensors_snapshot(&sensor_snap);
+
+  if (argc == 2 && strcmp(argv[1], "snap") == 0) {
+    printf("info: snapshot in %lu ms, %d bank%s failed\n",
+           sensor_snap.elapsed, fail, fail == 1 ? "" : "s");
+    return fail ? 1 : 0;
+  }
+
+  if (argc == 2 && strcmp(argv[1], "export") == 0)
+    return export_roach2_sensor_info(&sensor_snap);
+
+  print_roach2_sensor_info(&sensor_snap);
+  return 0;
 }
 
 U_BOOT_CMD(
-    r2sensor, 4, 1, do_roach2_sensors,
+    r2sensor, 2, 1, do_roach2_sensors,
     "access roach2 sensors",
-    "[dump] - dump roach2 sensor information"
+    "[dump] - read and dump roach2 sensor information\n"
+    "r2sensor snap - read all sensors into the snapshot only\n"
+    "r2sensor cached - dump the last snapshot without reading the sensors\n"
+    "r2sensor export - read all sensors into sens_mv, sens_ma, sens_temp, sens_rpm\n"
 );
 
 #endif /* CONFIG_CMD_R2SENSORS */ 
@@ -17,54 +17,151 @@
 
 #include <common.h>
 #include <command.h>
+#include <net.h>
+#include <malloc.h>
+#include <u-boot/crc.h>
+#ifdef CONFIG_GZIP
+#include <u-boot/zlib.h>
+#endif
+#ifdef CONFIG_LZMA
+#include <lzma/LzmaTypes.h>
+#include <lzma/LzmaDec.h>
+#endif
+#ifdef CONFIG_LZO
+#include <linux/lzo.h>
+#endif
 
 #include <asm/processor.h>
 #include <asm/ppc4xx.h>
 #include <asm/ppc4xx-gpio.h>
 #include <asm/ppc4xx-ebc.h>
+#include <asm/unaligned.h>
 
 #include "include/smap.h"
+#include "include/fpga.h"
+#include "include/fpga_reg.h"
 #include "include/gpio.h"
+#include "include/sensors.h"
 
 #ifdef CONFIG_CMD_R2SMAP
 /**** ROACH 2 SelectMAP Programming ****/
 
-int smap_check_bitstream(u32 addr)
+/*
+ * Xilinx .bit files start with a fixed 13 byte preamble followed by
+ * tagged fields: 'a' design name, 'b' part, 'c' date and 'd' time, each
+ * with a 16 bit length, and finally 'e' with the 32 bit length of the
+ * configuration data that follows it.
+ */
+static const uchar smap_bit_preamble[SMAP_BIT_PREAMBLE_LEN] = {
+  0x00, 0x09, 0x0f, 0xf0, 0x0f, 0xf0, 0x0f, 0xf0, 0x0f, 0xf0, 0x00, 0x00, 0x01
+};
+
+static int smap_parse_header(uchar *buf, unsigned len, struct smap_bit_header *hdr)
 {
-  u32 sync_val_bin = *((u32 *)(addr + SMAP_SYNC_OFFSET_BIN));
-  u32 sync_val_bit = *((u32 *)(addr + SMAP_SYNC_OFFSET_BIT));
+  unsigned pos = SMAP_BIT_PREAMBLE_LEN;
+  unsigned flen;
+  uchar key;
+
+  if (len < SMAP_BIT_PREAMBLE_LEN ||
+      memcmp(buf, smap_bit_preamble, SMAP_BIT_PREAMBLE_LEN))
+    return -1;
+
+  memset(hdr, 0, sizeof(*hdr));
+
+  while (pos + 3 <= len) {
+    key = buf[pos++];
+    if (key == 'e') {
+      if (pos + 4 > len)
+        return -1;
+      hdr->length = get_unaligned_be32(buf + pos);
+      hdr->offset = pos + 4;
+      return 0;
+    }
+    flen = get_unaligned_be16(buf + pos);
+    pos += 2;
+    if (pos + flen > len || flen == 0 || buf[pos + flen - 1] != '\0')
+      return -1;
+    switch (key) {
+    case 'a':
+      hdr->design = (char *)buf + pos;
+      break;
+    case 'b':
+      hdr->part = (char *)buf + pos;
+      break;
+    case 'c':
+      hdr->date = (char *)buf + pos;
+      break;
+    case 'd':
+      hdr->time = (char *)buf + pos;
+      break;
+    default:
+      return -1;
+    }
+    pos += flen;
+  }
+
+  return -1;
+}
 
-  if (sync_val_bin == SMAP_SYNC_VALUE){
+/*
+ * Return the offset of the raw configuration data within the image, or
+ * -1 if no sync word is found. For .bit files the header is parsed,
+ * the part checked against the board and *length set to the exact
+ * payload length.
+ */
+int smap_check_bitstream(u32 addr, unsigned len, ulong *length)
+{
+  struct smap_bit_header hdr;
+  u32 sync_val;
+
+  if (!smap_parse_header((uchar *)addr, len, &hdr)) {
+    printf("info: design %s, part %s, built %s %s, %u bytes\n",
+           hdr.design ? hdr.design : "?", hdr.part ? hdr.part : "?",
+           hdr.date ? hdr.date : "?", hdr.time ? hdr.time : "", hdr.length);
+
+    if (!hdr.part || strncmp(hdr.part, SMAP_FPGA_PART, strlen(SMAP_FPGA_PART))) {
+      printf("error: bitstream is for part %s, board has %s\n",
+             hdr.part ? hdr.part : "?", SMAP_FPGA_PART);
+      return -1;
+    }
+
+    if (hdr.offset + SMAP_SYNC_OFFSET_BIN + 4 > len ||
+        get_unaligned_be32((uchar *)addr + hdr.offset + SMAP_SYNC_OFFSET_BIN) != SMAP_SYNC_VALUE) {
 #ifdef DEBUG
-    printf("info: detected a valid .bin\n");
+      printf("info: .bit payload does not carry the sync symbol\n");
 #endif
-    return 0;
-  } else if (sync_val_bit == SMAP_SYNC_VALUE){
+      return -1;
+    }
+
 #ifdef DEBUG
     printf("info: detected a valid .bit\n");
 #endif
+    *length = hdr.length;
     /* return the offset into addr from which the real file starts */
-    return SMAP_SYNC_OFFSET_BIT - SMAP_SYNC_OFFSET_BIN;
-  } else {
+    return hdr.offset;
+  }
+
+  sync_val = *((u32 *)(addr + SMAP_SYNC_OFFSET_BIN));
+  if (sync_val == SMAP_SYNC_VALUE){
 #ifdef DEBUG
-    printf("info: invalid bitstream sync symbol read; got %x \n", sync_val_bin);
-    printf("or    invalid bitstream sync symbol read; got %x \n", sync_val_bit);
+    printf("info: detected a valid .bin\n");
 #endif
-    return -1;
+    return 0;
   }
+
+#ifdef DEBUG
+  printf("info: invalid bitstream sync symbol read; got %x \n", sync_val);
+#endif
+  return -1;
 }
 
-int smap_program(u32 addr, unsigned int length)
+/* pulse PROG_B and wait for the v6 to release INIT_N */
+static int smap_reset(void)
 {
   int i;
-  int offset = 0;
-  volatile u32 *src;
-  volatile u32 *dst;
 
-  if ((offset = smap_check_bitstream(addr)) < 0){
-    printf("error: invalid bitstream detected\n");
-    return -1;
-  }
+  /* cached fpga register values do not survive a reload */
+  fpga_reg_invalidate();
 
   /* configure initn as output*/
   gpio_config(GPIO_SMAP_INITN, GPIO_OUT, GPIO_SEL, GPIO_OUT_1);
@@ -98,10 +195,86 @@ int smap_program(u32 addr, unsigned int length)
     }
   }
 
-  src = (u32 *)(addr + offset);
-  dst = (u32 *)(CONFIG_SYS_SMAP_BASE);
+  return 0;
+}
+
+static int smap_wait_done(void)
+{
+  int i;
+
+  for (i=0; i < SMAP_DONE_WAIT + 1; i++){
+    if (gpio_read_in_bit(GPIO_SMAP_DONE)){
+      return 0;
+    }
+  }
+
+  /* the v6 pulls init_n low when it detects a configuration crc error */
+  if (!gpio_read_in_bit(GPIO_SMAP_INITN))
+    printf("error: SelectMAP programming failed, init_n low (crc error)\n");
+  else
+    printf("error: SelectMAP programming failed, done stuck low\n");
+  return 1;
+}
+
+/*
+ * The crc32 of the last programmed image is kept in an FPGA scratch
+ * register. It survives a PowerPC reset as long as the v6 stays
+ * configured, so a warm boot can skip reloading an identical image.
+ * Gateware without the BSP register block is always reprogrammed.
+ */
+static int smap_bsp_present(void)
+{
+  if (!gpio_read_in_bit(GPIO_SMAP_DONE))
+    return 0;
+  return *((volatile u32 *)(CONFIG_SYS_FPGA_BASE + BSP_REG_BOARDID)) == BSP_BOARDID;
+}
+
+static int smap_is_loaded(u32 crc)
+{
+  u32 offset = CONFIG_SYS_FPGA_BASE;
 
-  for(i = 0; i < length; i+=16){
+  if (!smap_bsp_present())
+    return 0;
+  if (*((volatile u32 *)(offset + BSP_REG_SCRATCH(SMAP_CRC_SCRATCH))) != crc)
+    return 0;
+
+  printf("info: image already loaded (crc %08x, rev %x.%x.%x), skipping\n", crc,
+         *((volatile u32 *)(offset + BSP_REG_REVMAJ)),
+         *((volatile u32 *)(offset + BSP_REG_REVMIN)),
+         *((volatile u32 *)(offset + BSP_REG_REVRCS)));
+  return 1;
+}
+
+static void smap_record_loaded(u32 crc)
+{
+  char buf[16];
+
+  sprintf(buf, "%08x", crc);
+  setenv("smapcrc", buf);
+
+  if (smap_bsp_present())
+    *((volatile u32 *)(CONFIG_SYS_FPGA_BASE + BSP_REG_SCRATCH(SMAP_CRC_SCRATCH))) = crc;
+}
+
+/* what is loaded now has no known crc */
+static void smap_forget_loaded(void)
+{
+  setenv("smapcrc", NULL);
+  if (smap_bsp_present())
+    *((volatile u32 *)(CONFIG_SYS_FPGA_BASE + BSP_REG_SCRATCH(SMAP_CRC_SCRATCH))) = 0;
+}
+
+/*
+ * Clock length bytes at src out of the SelectMAP port, a last partial
+ * word padded with zeros. Gives up, returning -1, when over temperature.
+ */
+static int smap_clock_out(volatile u32 *src, unsigned int length)
+{
+  volatile u32 *dst = (u32 *)(CONFIG_SYS_SMAP_BASE);
+  unsigned int i;
+  u32 tail;
+
+  for(i = 0; i + 16 <= length; i+=16){
 #ifdef DEBUG
     if (i < (16 * 4))
       printf("%d: loaded smap data %8x\n", i, *src);
@@ -112,39 +285,783 @@ int smap_program(u32 addr, unsigned int length)
     *dst = *src++;
     *dst = *src++;
     *dst = *src++;
+
+    if (!(i & 0xffff) && thermal_poll()) {
+      printf("error: configuration aborted, over temperature\n");
+      return -1;
+    }
   }
 
-  for (i=0; i < SMAP_DONE_WAIT + 1; i++){
-    if (gpio_read_in_bit(GPIO_SMAP_DONE)){
+  for (; i < length; i += 4) {
+    if (length - i >= 4) {
+      *dst = *src++;
+    } else {
+      tail = 0;
+      memcpy(&tail, (void *)src, length - i);
+      *dst = tail;
+    }
+  }
+  return 0;
+}
+
+int smap_program(u32 addr, unsigned int length, u32 flags)
+{
+  int offset = 0;
+  u32 crc = 0;
+
+  ulong hdr_length = SMAP_IMAGE_SIZE;
+
+  if ((offset = smap_check_bitstream(addr, SMAP_HEADER_MAX, &hdr_length)) < 0){
+    printf("error: invalid bitstream detected\n");
+    return -1;
+  }
+
+  /* no explicit length: clock out exactly the .bit payload */
+  if (length == 0)
+    length = hdr_length;
+
+  /*
+   * The crc is only worth its cost (seconds over the uncached SDRAM
+   * mapping) for the skip check; a forced load is not recorded.
+   */
+  if (!(flags & SMAP_FLAG_FORCE)) {
+    crc = crc32(0, (uchar *)(addr + offset), length);
+    if (smap_is_loaded(crc))
       return 0;
+  }
+
+  if (smap_reset())
+    return -1;
+
+  /* an unfinished image leaves the fpga unconfigured, and cooler */
+  if (smap_clock_out((u32 *)(addr + offset), length))
+    return -1;
+
+  if (smap_wait_done())
+    return 1;
+
+  if (flags & SMAP_FLAG_FORCE)
+    smap_forget_loaded();
+  else
+    smap_record_loaded(crc);
+  return 0;
+}
+
+/*
+ * Partial reconfiguration: the partial image only carries the frames of
+ * a reconfigurable region and must be loaded into a running device, so
+ * PROG_B is left alone and the v6 keeps DONE high throughout. INIT_N
+ * drops if the partial image fails its crc check.
+ */
+int smap_program_partial(u32 addr, unsigned int length)
+{
+  ulong hdr_length = 0, start, elapsed;
+  int offset;
+
+  if ((offset = smap_check_bitstream(addr, SMAP_HEADER_MAX, &hdr_length)) < 0){
+    printf("error: invalid bitstream detected\n");
+    return -1;
+  }
+
+  if (length == 0)
+    length = hdr_length;
+  if (length == 0){
+    printf("error: partial .bin images need an explicit length\n");
+    return -1;
+  }
+
+  if (!gpio_read_in_bit(GPIO_SMAP_DONE)){
+    printf("error: fpga not configured, load a full image first\n");
+    return -1;
+  }
+
+  /* the static image recorded by smapcrc is no longer what is loaded */
+  fpga_reg_invalidate();
+  smap_forget_loaded();
+
+  start = get_timer(0);
+
+  gpio_write_bit(GPIO_SMAP_RDWRN, 0);
+  /* aborted part way, the region is left partly written and needs a reload */
+  if (smap_clock_out((u32 *)(addr + offset), length))
+    return -1;
+
+  elapsed = get_timer(start);
+
+  if (!gpio_read_in_bit(GPIO_SMAP_INITN)){
+    printf("error: partial reconfiguration failed, init_n low (crc error)\n");
+    return 1;
+  }
+  if (!gpio_read_in_bit(GPIO_SMAP_DONE)){
+    printf("error: partial reconfiguration failed, done dropped\n");
+    return 1;
+  }
+
+  printf("info: %u bytes reconfigured in %lu ms\n", length, elapsed);
+  return 0;
+}
+
+/*
+ * Streaming SelectMAP programming: the image is handed over in chunks
+ * (tftp blocks or decompressor output) and written to the SelectMAP port
+ * as it becomes available. Chunk boundaries do not fall on word
+ * boundaries once the .bit header is stripped, so up to three bytes are
+ * carried over to the next chunk.
+ */
+static struct {
+  ulong next;   /* file offset of the next expected block */
+  ulong left;   /* bytes that may still be written to the port */
+  int skip;     /* header bytes still to be discarded */
+  u32 crc;      /* crc32 of the bytes written so far */
+  u32 word;     /* partially assembled data word */
+  int nbytes;   /* number of valid bytes in word */
+} smap_stream;
+
+/* check the sync word in the first chunk and reset the v6 */
+static int smap_stream_start(uchar *head, unsigned len, ulong limit)
+{
+  ulong hdr_length = ~0UL;
+  int skip;
+
+  if (len < SMAP_SYNC_OFFSET_BIN + 4) {
+    printf("error: first chunk too short for sync detection\n");
+    return -1;
+  }
+  if ((skip = smap_check_bitstream((u32)head, len, &hdr_length)) < 0) {
+    printf("error: invalid bitstream detected\n");
+    return -1;
+  }
+  if (smap_reset())
+    return -1;
+
+  smap_stream.skip = skip;
+  smap_stream.left = limit ? limit : hdr_length;
+  smap_stream.crc = 0;
+  smap_stream.nbytes = 0;
+  return 0;
+}
+
+static void smap_stream_write(uchar *src, unsigned len)
+{
+  volatile u32 *dst = (u32 *)(CONFIG_SYS_SMAP_BASE);
+  int skip;
+
+  if (smap_stream.skip) {
+    skip = min(smap_stream.skip, (int)len);
+    smap_stream.skip -= skip;
+    src += skip;
+    len -= skip;
+  }
+
+  if (len > smap_stream.left)
+    len = smap_stream.left;
+  smap_stream.left -= len;
+  smap_stream.crc = crc32(smap_stream.crc, src, len);
+
+  /* complete a word left over from the previous chunk */
+  while (smap_stream.nbytes && len) {
+    smap_stream.word = (smap_stream.word << 8) | *src++;
+    len--;
+    if (++smap_stream.nbytes == 4) {
+      *dst = smap_stream.word;
+      smap_stream.nbytes = 0;
     }
   }
 
-  printf("error: SelectMAP programming failed, done stuck low\n");
-  return 1;
+  for (; len >= 4; len -= 4, src += 4)
+    *dst = *((u32 *)src);
+
+  while (len--) {
+    smap_stream.word = (smap_stream.word << 8) | *src++;
+    smap_stream.nbytes++;
+  }
+}
+
+static void smap_stream_flush(void)
+{
+  volatile u32 *dst = (u32 *)(CONFIG_SYS_SMAP_BASE);
+
+  if (smap_stream.nbytes) {
+    /* pad the tail of the image */
+    *dst = smap_stream.word << (8 * (4 - smap_stream.nbytes));
+    smap_stream.nbytes = 0;
+  }
+}
+
+#if defined(CONFIG_CMD_NET) && defined(CONFIG_TFTP_STORE_HOOK)
+static int smap_tftp_store(ulong offset, uchar *src, unsigned len)
+{
+  if (offset == 0) {
+    /* first block, or the transfer was restarted from the beginning */
+    putc('\n');
+    if (smap_stream_start(src, len, 0))
+      return -1;
+  } else if (offset != smap_stream.next) {
+    printf("\nerror: unexpected block at offset %lu, wanted %lu\n",
+           offset, smap_stream.next);
+    return -1;
+  }
+  smap_stream.next = offset + len;
+
+  if (thermal_poll()) {
+    printf("\nerror: configuration aborted, over temperature\n");
+    return -1;
+  }
+  smap_stream_write(src, len);
+
+  return 0;
+}
+
+static int smap_program_tftp(char *file)
+{
+  int size;
+
+  copy_filename(BootFile, file, sizeof(BootFile));
+
+  smap_stream.next = 0;
+  TftpStoreHook = smap_tftp_store;
+  size = NetLoop(TFTP);
+  TftpStoreHook = NULL;
+
+  if (size < 0)
+    return -1;
+
+  smap_stream_flush();
+
+  printf("info: streamed %d bytes to SelectMAP\n", size);
+
+  if (smap_wait_done())
+    return 1;
+
+  smap_record_loaded(smap_stream.crc);
+  return 0;
+}
+#endif
+
+/**** Compressed bitstreams ****/
+
+/*
+ * Compressed images are inflated SMAP_CHUNK_SIZE bytes at a time and
+ * pushed straight into the SelectMAP port, so the raw image never
+ * exists in memory. The compressed streams are self-terminating; the
+ * .bit header or the length argument bounds the bytes clocked out.
+ */
+static uchar smap_chunk[SMAP_CHUNK_SIZE] __attribute__((aligned(4)));
+
+/* the stream has been started and its byte budget used up */
+#define SMAP_STREAM_FULL(total) ((total) && !smap_stream.left)
+
+/* feed one chunk of decompressed data, starting the stream on the first */
+static int smap_chunk_out(uchar *src, unsigned len, ulong *total, ulong limit)
+{
+  if (*total == 0 && smap_stream_start(src, len, limit))
+    return -1;
+  if (thermal_poll()) {
+    printf("error: configuration aborted, over temperature\n");
+    return -1;
+  }
+  smap_stream_write(src, len);
+  *total += len;
+  return 0;
+}
+
+static int smap_detect_comp(uchar *src)
+{
+  if (src[0] == SMAP_GZIP_MAGIC0 && src[1] == SMAP_GZIP_MAGIC1)
+    return SMAP_COMP_GZIP;
+  if (src[0] == SMAP_LZMA_PROPS && src[1] == 0x00)
+    return SMAP_COMP_LZMA;
+  if (src[0] == SMAP_LZOP_MAGIC0 && src[1] == 'L' && src[2] == 'Z' && src[3] == 'O')
+    return SMAP_COMP_LZO;
+  return SMAP_COMP_NONE;
+}
+
+#ifdef CONFIG_GZIP
+void *zalloc(void *, unsigned, unsigned);
+void zfree(void *, void *, unsigned);
+
+static int smap_inflate_gzip(uchar *src, ulong srclen, ulong limit, ulong *total)
+{
+  z_stream s;
+  int r;
+
+  memset(&s, 0, sizeof(s));
+  s.zalloc = zalloc;
+  s.zfree = zfree;
+
+  /* 16 + MAX_WBITS lets zlib parse and check the gzip wrapper */
+  r = inflateInit2(&s, 16 + MAX_WBITS);
+  if (r != Z_OK) {
+    printf("error: inflateInit2() returned %d\n", r);
+    return -1;
+  }
+
+  s.next_in = src;
+  s.avail_in = srclen;
+
+  do {
+    s.next_out = smap_chunk;
+    s.avail_out = SMAP_CHUNK_SIZE;
+    r = inflate(&s, Z_SYNC_FLUSH);
+    if (r != Z_OK && r != Z_STREAM_END) {
+      printf("error: inflate() returned %d\n", r);
+      break;
+    }
+    if (smap_chunk_out(smap_chunk, SMAP_CHUNK_SIZE - s.avail_out, total, limit)) {
+      r = Z_DATA_ERROR;
+      break;
+    }
+  } while (r != Z_STREAM_END && !SMAP_STREAM_FULL(*total));
+
+  inflateEnd(&s);
+
+  return (r == Z_STREAM_END || SMAP_STREAM_FULL(*total)) ? 0 : -1;
+}
+#endif /* CONFIG_GZIP */
+
+#ifdef CONFIG_LZMA
+static void *smap_lzma_alloc(void *p, size_t size) { return malloc(size); }
+static void smap_lzma_free(void *p, void *address) { free(address); }
+
+/* .lzma: props[5], 64 bit little endian size, data */
+static int smap_inflate_lzma(uchar *src, ulong srclen, ulong limit, ulong *total)
+{
+  ISzAlloc alloc = {smap_lzma_alloc, smap_lzma_free};
+  CLzmaDec state;
+  ELzmaStatus status;
+  SizeT inlen, outlen;
+  SRes res;
+  u32 size;
+  int ret = 0;
+
+  if (srclen < LZMA_PROPS_SIZE + 8)
+    return -1;
+
+  /* without an end mark the stream ends after the size in the header */
+  size = get_unaligned_le32(src + LZMA_PROPS_SIZE);
+  if (get_unaligned_le32(src + LZMA_PROPS_SIZE + 4))
+    size = 0;
+
+  LzmaDec_Construct(&state);
+  res = LzmaDec_Allocate(&state, src, LZMA_PROPS_SIZE, &alloc);
+  if (res != SZ_OK) {
+    printf("error: cannot allocate lzma dictionary (%d), use a smaller one\n", res);
+    return -1;
+  }
+  LzmaDec_Init(&state);
+
+  src += LZMA_PROPS_SIZE + 8;
+  srclen -= LZMA_PROPS_SIZE + 8;
+
+  do {
+    inlen = srclen;
+    outlen = SMAP_CHUNK_SIZE;
+    res = LzmaDec_DecodeToBuf(&state, smap_chunk, &outlen, src, &inlen,
+                              LZMA_FINISH_ANY, &status);
+    if (res != SZ_OK) {
+      printf("error: lzma decode failed (%d)\n", res);
+      ret = -1;
+      break;
+    }
+    src += inlen;
+    srclen -= inlen;
+    if (smap_chunk_out(smap_chunk, outlen, total, limit)) {
+      ret = -1;
+      break;
+    }
+    if (inlen == 0 && outlen == 0)
+      break;
+  } while (status != LZMA_STATUS_FINISHED_WITH_MARK && !SMAP_STREAM_FULL(*total));
+
+  /* ran out of input before the end of the stream: a truncated image */
+  if (!ret && status != LZMA_STATUS_FINISHED_WITH_MARK &&
+      !SMAP_STREAM_FULL(*total) && !(size && *total == size)) {
+    printf("error: lzma stream truncated\n");
+    ret = -1;
+  }
+
+  LzmaDec_Free(&state, &alloc);
+
+  return ret;
+}
+#endif /* CONFIG_LZMA */
+
+#ifdef CONFIG_LZO
+/* lzop header fields ahead of the first block, see lib/lzo */
+static uchar *smap_lzop_skip_header(uchar *src)
+{
+  u16 version;
+  int i;
+
+  src += SMAP_LZOP_MAGIC_LEN;
+  version = get_unaligned_be16(src);
+  src += 7;
+  if (version >= 0x0940)
+    src++;
+  if (get_unaligned_be32(src) & 0x00000800)
+    src += 4;
+  src += 12;
+  if (version >= 0x0940)
+    src += 4;
+  i = *src++;
+  return src + i + 4;
+}
+
+/* lzop images are a sequence of independently compressed blocks */
+static int smap_inflate_lzo(uchar *src, ulong srclen, ulong limit, ulong *total)
+{
+  uchar *send = src + srclen;
+  uchar *buf = NULL;
+  u32 slen, dlen, buflen = 0;
+  size_t tmp;
+  int ret = -1;
+
+  src = smap_lzop_skip_header(src);
+
+  while (src < send && !SMAP_STREAM_FULL(*total)) {
+    /* a block is dlen, slen and a checksum, the end marker only dlen */
+    if (send - src < 4)
+      break;
+    dlen = get_unaligned_be32(src);
+    src += 4;
+    if (dlen == 0) {
+      ret = 0;
+      break;
+    }
+    if (send - src < 8)
+      break;
+    slen = get_unaligned_be32(src);
+    src += 8;
+    if (slen > dlen || slen > send - src)
+      break;
+
+    if (dlen > buflen) {
+      free(buf);
+      buflen = dlen;
+      if ((buf = malloc(buflen)) == NULL) {
+        printf("error: cannot allocate %u byte lzo block\n", buflen);
+        return -1;
+      }
+    }
+
+    tmp = dlen;
+    if (slen == dlen) {
+      /* stored uncompressed */
+      memcpy(buf, src, dlen);
+    } else if (lzo1x_decompress_safe(src, slen, buf, &tmp) != LZO_E_OK || tmp != dlen) {
+      printf("error: lzo block decompression failed\n");
+      break;
+    }
+    if (smap_chunk_out(buf, dlen, total, limit))
+      break;
+    src += slen;
+  }
+  if (SMAP_STREAM_FULL(*total))
+    ret = 0;
+
+  free(buf);
+  return ret;
+}
+#endif /* CONFIG_LZO */
+
+/*
+ * srclen is the size of the compressed file, so a truncated image runs
+ * out of input and fails instead of being decoded past its end. The
+ * bytes clocked out are bounded by the .bit header, a .bin stream ends
+ * by itself.
+ */
+int smap_program_compressed(u32 addr, ulong srclen)
+{
+  uchar *src = (uchar *)addr;
+  ulong total = 0;
+  int ret;
+
+  switch (smap_detect_comp(src)) {
+#ifdef CONFIG_GZIP
+  case SMAP_COMP_GZIP:
+    printf("info: inflating gzip bitstream\n");
+    ret = smap_inflate_gzip(src, srclen, 0, &total);
+    break;
+#endif
+#ifdef CONFIG_LZMA
+  case SMAP_COMP_LZMA:
+    printf("info: inflating lzma bitstream\n");
+    ret = smap_inflate_lzma(src, srclen, 0, &total);
+    break;
+#endif
+#ifdef CONFIG_LZO
+  case SMAP_COMP_LZO:
+    printf("info: inflating lzo bitstream\n");
+    ret = smap_inflate_lzo(src, srclen, 0, &total);
+    break;
+#endif
+  default:
+    printf("error: unsupported bitstream compression\n");
+    return -1;
+  }
+
+  if (ret)
+    return -1;
+
+  smap_stream_flush();
+
+  printf("info: inflated %lu bytes to SelectMAP\n", total);
+
+  if (smap_wait_done())
+    return 1;
+
+  smap_record_loaded(smap_stream.crc);
+  return 0;
+}
+
+/**** Readback verification ****/
+
+/*
+ * Find the FDRI frame data in a configuration stream. The packets after
+ * the sync word are walked until the FDRI write, which on the v6 is a
+ * type 1 header with a zero count followed by a type 2 word count.
+ */
+static uchar *smap_find_fdri(uchar *img, ulong len, ulong *nwords)
+{
+  ulong pos = SMAP_SYNC_OFFSET_BIN + 4;
+  u32 hdr, count;
+
+  while (pos + 4 <= len) {
+    hdr = get_unaligned_be32(img + pos);
+    pos += 4;
+    if (SMAP_PKT_TYPE(hdr) != SMAP_PKT_TYPE1)
+      continue;
+    count = SMAP_PKT_T1_COUNT(hdr);
+    if (SMAP_PKT_OP(hdr) == SMAP_PKT_OP_WRITE && SMAP_PKT_REG(hdr) == SMAP_REG_FDRI) {
+      if (count == 0) {
+        hdr = get_unaligned_be32(img + pos);
+        pos += 4;
+        if (SMAP_PKT_TYPE(hdr) != SMAP_PKT_TYPE2)
+          return NULL;
+        count = SMAP_PKT_T2_COUNT(hdr);
+      }
+      if (pos + count * 4 > len)
+        return NULL;
+      *nwords = count;
+      return img + pos;
+    }
+    pos += count * 4;
+  }
+  return NULL;
+}
+
+static void smap_write_seq(const u32 *seq, int n)
+{
+  volatile u32 *dst = (u32 *)(CONFIG_SYS_SMAP_BASE);
+
+  while (n--)
+    *dst = *seq++;
+}
+
+/* readback command sequence, UG360 "Readback Command Sequences" */
+static void smap_readback_start(ulong nwords)
+{
+  u32 seq[] = {
+    SMAP_DUMMY_WORD, SMAP_SYNC_VALUE, SMAP_NOOP,
+    SMAP_PKT_WR_CMD, SMAP_CMD_RCRC, SMAP_NOOP, SMAP_NOOP,
+    SMAP_PKT_WR_CMD, SMAP_CMD_RCFG,
+    SMAP_PKT_WR_FAR, 0x00000000,
+    SMAP_PKT_RD_FDRO, SMAP_PKT_TYPE2_RD | nwords,
+    SMAP_NOOP, SMAP_NOOP, SMAP_NOOP, SMAP_NOOP,
+    SMAP_NOOP, SMAP_NOOP, SMAP_NOOP, SMAP_NOOP,
+  };
+
+  gpio_write_bit(GPIO_SMAP_RDWRN, 0);
+  smap_write_seq(seq, ARRAY_SIZE(seq));
+  /* CS is only asserted during bus cycles, so RD_WR_N may flip here */
+  gpio_write_bit(GPIO_SMAP_RDWRN, 1);
+}
+
+static void smap_readback_end(void)
+{
+  u32 seq[] = {
+    SMAP_NOOP, SMAP_PKT_WR_CMD, SMAP_CMD_DESYNC, SMAP_NOOP, SMAP_NOOP,
+  };
+
+  gpio_write_bit(GPIO_SMAP_RDWRN, 0);
+  smap_write_seq(seq, ARRAY_SIZE(seq));
+}
+
+/*
+ * Read the configuration frames back and compare them with the FDRI
+ * data of the source image. Bits set in the optional mask image (bitgen
+ * -m) are ignored; they cover frames whose content changes at run time.
+ * The first mismatching frame ends the comparison, the rest of the
+ * readback is drained so the configuration logic is left idle.
+ */
+int smap_verify(u32 addr, u32 mask_addr)
+{
+  volatile u32 *smap = (u32 *)(CONFIG_SYS_SMAP_BASE);
+  uchar *src, *img, *msk = NULL;
+  ulong length = SMAP_IMAGE_SIZE, nwords, mwords, i;
+  ulong start, elapsed;
+  u32 r, d, m, crc = 0;
+  int offset, ret = 0;
+
+  if ((offset = smap_check_bitstream(addr, SMAP_HEADER_MAX, &length)) < 0) {
+    printf("error: invalid bitstream detected\n");
+    return -1;
+  }
+  img = (uchar *)addr + offset;
+  if ((src = smap_find_fdri(img, length, &nwords)) == NULL) {
+    printf("error: no frame data found in bitstream\n");
+    return -1;
+  }
+
+  if (mask_addr) {
+    length = SMAP_IMAGE_SIZE;
+    if ((offset = smap_check_bitstream(mask_addr, SMAP_HEADER_MAX, &length)) < 0) {
+      printf("error: invalid mask image detected\n");
+      return -1;
+    }
+    img = (uchar *)mask_addr + offset;
+    if ((msk = smap_find_fdri(img, length, &mwords)) == NULL || mwords != nwords) {
+      printf("error: mask image does not match bitstream\n");
+      return -1;
+    }
+  }
+
+  if (!gpio_read_in_bit(GPIO_SMAP_DONE)) {
+    printf("error: fpga not configured, nothing to read back\n");
+    return -1;
+  }
+
+  printf("info: reading back %lu frames\n", nwords / SMAP_FRAME_WORDS);
+
+  start = get_timer(0);
+
+  /* the v6 returns a pad frame ahead of the requested data */
+  smap_readback_start(nwords + SMAP_FRAME_WORDS);
+  for (i = 0; i < SMAP_FRAME_WORDS; i++)
+    r = *smap;
+
+  for (i = 0; i < nwords; i++) {
+    r = *smap;
+    d = get_unaligned_be32(src + i * 4);
+    m = msk ? get_unaligned_be32(msk + i * 4) : 0;
+    if ((r ^ d) & ~m) {
+      printf("error: frame %lu mismatch at word %lu, got %08x, expected %08x\n",
+             i / SMAP_FRAME_WORDS, i % SMAP_FRAME_WORDS, r, d);
+      ret = 1;
+      break;
+    }
+    /* running crc over the unmasked configuration bits */
+    r &= ~m;
+    crc = crc32(crc, (uchar *)&r, 4);
+  }
+
+  /* drain the rest of the readback */
+  for (i++; i < nwords; i++)
+    r = *smap;
+
+  smap_readback_end();
+
+  elapsed = get_timer(start);
+  printf("info: %lu bytes read back in %lu ms", nwords * 4, elapsed);
+  if (elapsed)
+    printf(" (%lu KB/s)", (nwords * 4) / elapsed);
+  printf(", crc %08x\n", crc);
+
+  return ret;
 }
 
 static int do_roach2_smap(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
   ulong addr, length;
+  u32 flags = 0;
+  char *s;
+  int ret;
 
-  length = SMAP_IMAGE_SIZE;
+  /* 0: use the .bit payload length, or SMAP_IMAGE_SIZE for a .bin */
+  length = 0;
+
+  if (argc > 1 && !strcmp(argv[1], "-f")) {
+    flags |= SMAP_FLAG_FORCE;
+    argc--;
+    argv++;
+  }
 
   if (argc < 2) {
     printf ("Usage:\n%s\n", cmdtp->usage);
     return 1;
   }
 
+  if (!strcmp(argv[1], "verify")) {
+    if (argc < 3) {
+      printf ("Usage:\n%s\n", cmdtp->usage);
+      return 1;
+    }
+    addr = simple_strtoul(argv[2], NULL, 16);
+    if (smap_verify(addr, argc > 3 ? simple_strtoul(argv[3], NULL, 16) : 0)) {
+      printf("error: SelectMAP readback verification failed\n");
+      return -1;
+    }
+    printf("info: SelectMAP readback verification succeeded\n");
+    return 0;
+  }
+
+  if (!strcmp(argv[1], "partial")) {
+    if (argc < 3) {
+      printf ("Usage:\n%s\n", cmdtp->usage);
+      return 1;
+    }
+    addr = simple_strtoul(argv[2], NULL, 16);
+    if (argc > 3)
+      length = simple_strtoul(argv[3], NULL, 10);
+    if (smap_program_partial(addr, length)) {
+      printf("error: SelectMAP partial reconfiguration failed\n");
+      return -1;
+    }
+    printf("info: SelectMAP partial reconfiguration succeeded\n");
+    return 0;
+  }
+
+#if defined(CONFIG_CMD_NET) && defined(CONFIG_TFTP_STORE_HOOK)
+  if (!strcmp(argv[1], "tftp")) {
+    if (argc < 3) {
+      printf ("Usage:\n%s\n", cmdtp->usage);
+      return 1;
+    }
+    if (smap_program_tftp(argv[2])){
+      printf("error: SelectMAP configuration failed\n");
+      return -1;
+    }
+    printf("info: SelectMAP configuration succeeded\n");
+    return 0;
+  }
+#endif
+
   addr = simple_strtoul(argv[1], NULL, 16);
   if(argc > 2){
      length = simple_strtoul(argv[2], NULL, 10);
   }
 
-  printf("source %lx (%lu bytes)\n", addr, length);
+  if (length)
+    printf("source %lx (%lu bytes)\n", addr, length);
+  else
+    printf("source %lx\n", addr);
 
   /* */
 
-  if (smap_program(addr, length)){
+  if (smap_detect_comp((uchar *)addr) != SMAP_COMP_NONE) {
+    /* for a compressed image the length is that of the file */
+    if (!length && (s = getenv("filesize")) != NULL)
+      length = simple_strtoul(s, NULL, 16);
+    if (!length) {
+      printf("error: compressed image needs a length, or filesize set\n");
+      return -1;
+    }
+    ret = smap_program_compressed(addr, length);
+  } else {
+    ret = smap_program(addr, length, flags);
+  }
+
+  if (ret){
     printf("error: SelectMAP configuration failed\n");
     return -1;
   }
@@ -154,8 +1071,16 @@ static int do_roach2_smap(cmd_tbl_t *cmdtp, int flag, int argc, char * const arg
 }
 
 U_BOOT_CMD(
-	r2smap,	3,	1,	do_roach2_smap,
+	r2smap,	4,	1,	do_roach2_smap,
 	"program fpga using selectmap interface",
-	"<address> [length] - source address with optional length\n"
+	"[-f] <address> [length] - source address with optional length\n"
+	"    raw, gzip, lzma and lzop images are detected automatically;\n"
+	"    for compressed ones length is the file size, default $filesize\n"
+	"    a raw image already loaded in the fpga is skipped unless -f is given;\n"
+	"    -f also skips the image crc, so the load is not recorded\n"
+	"r2smap tftp <file> - stream bitstream from tftp server while it downloads\n"
+	"r2smap partial <address> [length] - load a partial bitstream into the\n"
+	"    running fpga without resetting it\n"
+	"r2smap verify <address> [mask] - read back the fpga and compare with image\n"
 );
 #endif /* CONFIG_CMD_R2SMAP */
@@ -0,0 +1,113 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+#include <common.h>
+
+#include "include/fpga.h"
+#include "include/fpga_reg.h"
+
+struct fpga_reg_stats fpga_reg_stats;
+
+const u32 fpga_qdrconf_base[4] = {
+  BSP_QDR0CONF_OFFSET, BSP_QDR1CONF_OFFSET, BSP_QDR2CONF_OFFSET, BSP_QDR3CONF_OFFSET,
+};
+
+const u32 fpga_qdr_base[4] = {
+  BSP_QDR0_OFFSET, BSP_QDR1_OFFSET, BSP_QDR2_OFFSET, BSP_QDR3_OFFSET,
+};
+
+const u32 fpga_zdok_base[2] = {
+  BSP_ZDOK0_OFFSET, BSP_ZDOK1_OFFSET,
+};
+
+void fpga_write_batch(u32 base, const struct fpga_reg_op *ops, int n)
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+    *((volatile u32 *)(base + ops[i].reg)) = ops[i].val;
+  fpga_reg_stats.writes += n;
+}
+
+void fpga_read_batch(u32 base, struct fpga_reg_op *ops, int n)
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+    ops[i].val = *((volatile u32 *)(base + ops[i].reg));
+  fpga_reg_stats.reads += n;
+}
+
+void fpga_write_block(u32 base, u32 reg, const u32 *src, int n)
+{
+  volatile u32 *dst = (u32 *)(base + reg);
+  int i;
+
+  for (i = 0; i < n; i++)
+    dst[i] = src[i];
+  fpga_reg_stats.writes += n;
+}
+
+void fpga_read_block(u32 base, u32 reg, u32 *dst, int n)
+{
+  volatile u32 *src = (u32 *)(base + reg);
+  int i;
+
+  for (i = 0; i < n; i++)
+    dst[i] = src[i];
+  fpga_reg_stats.reads += n;
+}
+
+void fpga_fill_block(u32 base, u32 reg, u32 val, int n)
+{
+  volatile u32 *dst = (u32 *)(base + reg);
+  int i;
+
+  for (i = 0; i < n; i++)
+    dst[i] = val;
+  fpga_reg_stats.writes += n;
+}
+
+/*
+ * Write coalescing: a small direct mapped table of the last value
+ * written to each cached register address.
+ */
+#define FPGA_REG_CACHE_SIZE 64
+
+static struct {
+  u32 addr;
+  u32 val;
+} fpga_reg_cache[FPGA_REG_CACHE_SIZE];
+
+void fpga_write_cached(u32 base, u32 reg, u32 val)
+{
+  u32 addr = base + reg;
+  int slot = (addr >> 2) % FPGA_REG_CACHE_SIZE;
+
+  if (fpga_reg_cache[slot].addr == addr && fpga_reg_cache[slot].val == val) {
+    fpga_reg_stats.coalesced++;
+    return;
+  }
+  fpga_reg_cache[slot].addr = addr;
+  fpga_reg_cache[slot].val = val;
+  fpga_write(base, reg, val);
+}
+
+void fpga_reg_invalidate(void)
+{
+  memset(fpga_reg_cache, 0, sizeof(fpga_reg_cache));
+}
@@ -1,5 +1,5 @@
-#ifndef _ROACH2_SMAP_H_
-#define _ROACH2_SMAP_H_
+#ifndef _ROACH2_BIT_H_
+#define _ROACH2_BIT_H_
 
 struct bit_mapping {
   int (*test) (int which, int subtest, u32 flags);
@@ -7,8 +7,19 @@ struct bit_mapping {
   uint devices;
   uint subtests;
   const char** subtest_name;
+  /* leading subtests run by 'r2bit all'; the rest only with BIT_FLAG_LONG */
+  uint batch_subtests;
 };
 
+/* 'r2bit all' flag: include the full-depth memory soaks */
+#define BIT_FLAG_LONG 0x1000
+
 extern char bit_strerr[256];
 
+/* for long loops: non-zero, with bit_strerr set, on ctrl-c or over temperature */
+int bit_abort(void);
+
+/* board id and scratchpad access check of the BSP register block */
+int v6comm_scratchtest(u32 flags);
+
 #endif /* __CMD_ROACH2_H__ */
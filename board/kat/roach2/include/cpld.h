@@ -5,6 +5,10 @@
 
 #define CPLD_REG_DIPS  0x10
 
+/* dip switches, active low */
+#define CPLD_DIPS_UART1     0x80
+#define CPLD_DIPS_FASTBOOT  0x40
+
 #define CPLD_REG_MAJOR  0x12
 #define CPLD_REG_MINOR  0x13
 
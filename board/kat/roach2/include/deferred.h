@@ -0,0 +1,18 @@
+#ifndef _ROACH2_DEFERRED_H_
+#define _ROACH2_DEFERRED_H_
+
+/*
+ * Board init steps that a fast boot leaves until first use. Each step
+ * runs at most once, either during boot or from r2_init_need() when a
+ * command first needs it. Steps still pending at bootm are listed in
+ * the device tree for Linux to pick up.
+ */
+#define R2_INIT_SENSORS 0
+#define R2_INIT_EEPROM  1
+#define R2_INIT_COUNT   2
+
+int r2_fastboot(void);
+int r2_init_need(int step);
+u32 r2_init_pending(void);
+
+#endif /* _ROACH2_DEFERRED_H_ */
@@ -37,8 +37,9 @@
 #define BSP_QDRM_WREN     0x100
 
 /* QDR memory depth (number of 144B entries) */
-//#define BSP_QDRM_DEPTH    (512*1024)
+#define BSP_QDRM_DEPTH_FULL (512*1024)
 
+/* depth covered by the quick ppc access test */
 #define BSP_QDRM_DEPTH    (1024)
 
 /* GPIO controller */
@@ -90,6 +91,13 @@
 
 #define BSP_DDR3_IS_HALF(x)  ((x%5)==0)
 
+/* bursts addressable through BSP_DDR3_REG_ADDR (in units of 8), each
+   carrying 16 full data words; the counter test probes address bit 24.
+   Not read back from the gateware: ddr3_full_test() checks it for
+   aliasing before the soak */
+#define BSP_DDR3_DEPTH       (1 << 25)
+#define BSP_DDR3_BURST_WORDS 16
+
 /* GBE definitions */
 
 #define BSP_GBE_OFFSET     0x600000
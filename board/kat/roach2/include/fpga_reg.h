@@ -0,0 +1,79 @@
+#ifndef _ROACH2_FPGA_REG_H_
+#define _ROACH2_FPGA_REG_H_
+
+/*
+ * Access layer for the BSP register blocks behind the FPGA chip select.
+ * Block bases come from per-controller tables, single accesses are
+ * inlined and counted, and blocks of registers can be moved with one
+ * call. fpga_write_cached() drops writes of a value the register
+ * already holds; use it only for registers the gateware never changes
+ * by itself, and call fpga_reg_invalidate() after reprogramming.
+ */
+
+/* absolute block bases, looked up per controller */
+extern const u32 fpga_qdrconf_base[4];
+extern const u32 fpga_qdr_base[4];
+extern const u32 fpga_zdok_base[2];
+
+#define FPGA_BSP_BASE         (CONFIG_SYS_FPGA_BASE)
+#define FPGA_QDRCONF_BASE(x)  (CONFIG_SYS_FPGA_BASE + fpga_qdrconf_base[(x) & 3])
+#define FPGA_QDR_BASE(x)      (CONFIG_SYS_FPGA_BASE + fpga_qdr_base[(x) & 3])
+#define FPGA_ZDOK_BASE(x)     (CONFIG_SYS_FPGA_BASE + fpga_zdok_base[(x) & 1])
+#define FPGA_DDR3_BASE        (CONFIG_SYS_FPGA_BASE)
+#define FPGA_GBE_BASE         (CONFIG_SYS_FPGA_BASE + BSP_GBE_OFFSET)
+#define FPGA_TGE_BASE(x)      (CONFIG_SYS_FPGA_BASE + BSP_TGE_OFFSET(x))
+
+struct fpga_reg_op {
+  u32 reg;
+  u32 val;
+};
+
+struct fpga_reg_stats {
+  ulong reads;
+  ulong writes;
+  ulong coalesced; /* cached writes that needed no bus access */
+};
+
+extern struct fpga_reg_stats fpga_reg_stats;
+
+void fpga_write_batch(u32 base, const struct fpga_reg_op *ops, int n);
+void fpga_read_batch(u32 base, struct fpga_reg_op *ops, int n);
+void fpga_write_block(u32 base, u32 reg, const u32 *src, int n);
+void fpga_read_block(u32 base, u32 reg, u32 *dst, int n);
+void fpga_fill_block(u32 base, u32 reg, u32 val, int n);
+
+void fpga_write_cached(u32 base, u32 reg, u32 val);
+void fpga_reg_invalidate(void);
+
+static inline void fpga_write(u32 base, u32 reg, u32 val)
+{
+  fpga_reg_stats.writes++;
+  *((volatile u32 *)(base + reg)) = val;
+}
+
+static inline u32 fpga_read(u32 base, u32 reg)
+{
+  fpga_reg_stats.reads++;
+  return *((volatile u32 *)(base + reg));
+}
+
+static inline void fpga_write16(u32 base, u32 reg, u16 val)
+{
+  fpga_reg_stats.writes++;
+  *((volatile u16 *)(base + reg)) = val;
+}
+
+static inline u16 fpga_read16(u32 base, u32 reg)
+{
+  fpga_reg_stats.reads++;
+  return *((volatile u16 *)(base + reg));
+}
+
+static inline void fpga_reg_stats_reset(void)
+{
+  fpga_reg_stats.reads = 0;
+  fpga_reg_stats.writes = 0;
+  fpga_reg_stats.coalesced = 0;
+}
+
+#endif /* _ROACH2_FPGA_REG_H_ */
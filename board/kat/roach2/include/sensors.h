@@ -207,4 +207,62 @@ struct max16071_pgood {
                      {"MGT_1V2", VMON, 2, PGOOD_ACTIVE_HIGH}, \
                      {"MGT_1V0", VMON, 3, PGOOD_ACTIVE_HIGH},}
 
+/*********** sensor snapshot *************/
+
+/*
+ * One pass over every monitor on the board, kept in RAM so that the
+ * values can be printed or exported without going back to the bus.
+ * The MAX16071 and AD7414 auto-increment their register pointer and
+ * are read with one transfer per device; the MAX1805 and MAX6650 do
+ * not, so only the registers used are fetched from those.
+ */
+#define SNAP_MAX16071_LEN 0x20 /* adc values through gpio inputs */
+
+#define SNAP_FAN_COUNT 4
+#define SNAP_AMBIENT_COUNT 2
+
+#define SNAP_VALID_VMON     (1 << 0)
+#define SNAP_VALID_CMON     (1 << 1)
+#define SNAP_VALID_AMBIENT0 (1 << 2)
+#define SNAP_VALID_AMBIENT1 (1 << 3)
+#define SNAP_VALID_REMOTE   (1 << 4)
+#define SNAP_VALID_FAN0     (1 << 5) /* one bit per fan */
+
+struct r2_sensor_snapshot {
+  ulong stamp;   /* get_timer() at the start of the pass */
+  ulong elapsed; /* ms spent on the bus */
+  u32 valid;     /* SNAP_VALID_* for each bank read */
+  u8 max16071[2][SNAP_MAX16071_LEN]; /* indexed by VMON/CMON */
+  u8 ambient[SNAP_AMBIENT_COUNT][2]; /* ad7414 TV msb and lsb */
+  u8 remote[2];                      /* max1805 DX1 and DX2 */
+  u8 remote_status;                  /* max1805 RS2 */
+  u8 fan_tach[SNAP_FAN_COUNT];
+  u8 fan_alarm[SNAP_FAN_COUNT];
+};
+
+extern struct r2_sensor_snapshot sensor_snap;
+extern const u8 snap_ambient_addr[SNAP_AMBIENT_COUNT];
+extern const u8 snap_fan_addr[SNAP_FAN_COUNT];
+
+int sensors_snapshot(struct r2_sensor_snapshot *snap);
+
+/*********** thermal control *************/
+
+#define THERMAL_POLL_MS   1000 /* minimum interval between samples */
+#define THERMAL_T_QUIET   45   /* dC, fpga fan at quiet speed up to here */
+#define THERMAL_T_FULL    75   /* dC, fpga fan at full speed from here */
+#define THERMAL_T_CRIT    90   /* dC, long operations abort */
+
+/* max6650 closed loop speed settings, larger is slower */
+#define THERMAL_FAN_QUIET 0x54 /* ~2900 RPM */
+#define THERMAL_FAN_FULL  0x1c /* ~8400 RPM */
+
+#ifdef CONFIG_ROACH2_THERMAL
+int thermal_poll(void);
+void thermal_reset(void);
+#else
+static inline int thermal_poll(void) { return 0; }
+static inline void thermal_reset(void) {}
+#endif
+
 #endif /*define _SENSORS_ROACH2_H_*/
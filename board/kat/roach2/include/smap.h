@@ -12,11 +12,63 @@
 #define GPIO_SMAP_LED   29
 #define GPIO_SMAP_KILLN 22
 
-/* 32 bit word offset of the sync symbol in the bitsream */
+/* byte offset of the sync symbol in a .bin bitstream */
 #define SMAP_SYNC_OFFSET_BIN  48
-#define SMAP_SYNC_OFFSET_BIT  146
 #define SMAP_SYNC_VALUE   0xaa995566
 
+/* Xilinx .bit file header */
+#define SMAP_BIT_PREAMBLE_LEN 13
+#define SMAP_HEADER_MAX       1024
+
+struct smap_bit_header {
+  char *design;
+  char *part;
+  char *date;
+  char *time;
+  u32 length; /* configuration data length in bytes */
+  int offset; /* start of configuration data in the file */
+};
+
+/* FPGA fitted to the board, as it appears in the .bit part field */
+#define SMAP_FPGA_PART "6vsx475t"
+
+/* smap_program() flags */
+#define SMAP_FLAG_FORCE 0x1 /* program even if the image is already loaded */
+
+/* FPGA scratch register holding the crc32 of the loaded image */
+#define SMAP_CRC_SCRATCH 3
+
+int smap_program(u32 addr, unsigned int length, u32 flags);
+
+/* Configuration packets, see UG360 */
+#define SMAP_DUMMY_WORD      0xffffffff
+#define SMAP_NOOP            0x20000000
+#define SMAP_FRAME_WORDS     81
+
+#define SMAP_PKT_TYPE(x)     (((x) >> 29) & 0x7)
+#define SMAP_PKT_TYPE1       0x1
+#define SMAP_PKT_TYPE2       0x2
+#define SMAP_PKT_OP(x)       (((x) >> 27) & 0x3)
+#define SMAP_PKT_OP_READ     0x1
+#define SMAP_PKT_OP_WRITE    0x2
+#define SMAP_PKT_REG(x)      (((x) >> 13) & 0x1f)
+#define SMAP_PKT_T1_COUNT(x) ((x) & 0x7ff)
+#define SMAP_PKT_T2_COUNT(x) ((x) & 0x07ffffff)
+
+#define SMAP_REG_FAR         0x01
+#define SMAP_REG_FDRI        0x02
+#define SMAP_REG_FDRO        0x03
+#define SMAP_REG_CMD         0x04
+
+#define SMAP_PKT_WR_CMD      0x30008001
+#define SMAP_PKT_WR_FAR      0x30002001
+#define SMAP_PKT_RD_FDRO     0x28006000
+#define SMAP_PKT_TYPE2_RD    0x48000000
+
+#define SMAP_CMD_RCFG        0x00000004
+#define SMAP_CMD_RCRC        0x00000007
+#define SMAP_CMD_DESYNC      0x0000000d
+
 /* Delay fors smap checks */
 #define SMAP_INITN_WAIT 100000
 #define SMAP_DONE_WAIT  100000
@@ -24,4 +76,18 @@
 /* Default SX475T image size in bytes */
 #define SMAP_IMAGE_SIZE 19586188
 
+/* Compressed images are inflated in chunks of this size */
+#define SMAP_CHUNK_SIZE 8192
+
+#define SMAP_COMP_NONE 0
+#define SMAP_COMP_GZIP 1
+#define SMAP_COMP_LZMA 2
+#define SMAP_COMP_LZO  3
+
+#define SMAP_GZIP_MAGIC0  0x1f
+#define SMAP_GZIP_MAGIC1  0x8b
+#define SMAP_LZMA_PROPS   0x5d /* lc=3, lp=0, pb=2 as used by lzma/xz */
+#define SMAP_LZOP_MAGIC0  0x89
+#define SMAP_LZOP_MAGIC_LEN 9
+
 #endif /* __CMD_ROACH2_H__ */
@@ -34,11 +34,18 @@
 #include <asm/io.h>
 #include <asm/bitops.h>
 #include <asm/ppc4xx-ebc.h>
+#include <asm/ppc4xx-gpio.h>
 #include <i2c.h>
+#include <net.h>
+#include <netdev.h>
+#include <bootstage.h>
 
 
 #include "include/cpld.h"
 #include "include/eeprom.h"
+#include "include/deferred.h"
+#include "include/fpga.h"
+#include "include/smap.h"
 
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -47,13 +54,18 @@ extern flash_info_t flash_info[CONFIG_SYS_MAX_FLASH_BANKS]; /* info for FLASH ch
 
 ulong flash_get_size(ulong base, int banknum);
 
+static int roach2_eeprom_read(u8 *data_buf)
+{
+        return i2c_read(R2_EEPROM_AT24HC04B_U38_I2C_ADDR, R2_EEPROM_AT24HC04B_SERIAL, 1, data_buf, R2_EEPROM_AT24HC04B_SERIAL_LEN);
+}
+
 static int dump_roach2_eeprom(void)
 {
         u8 data_buf [R2_EEPROM_AT24HC04B_SERIAL_LEN];
         u8 mac_str[18];
         char *s;
 
-        if (i2c_read(R2_EEPROM_AT24HC04B_U38_I2C_ADDR, R2_EEPROM_AT24HC04B_SERIAL, 1, data_buf, R2_EEPROM_AT24HC04B_SERIAL_LEN) != 0) {
+        if (roach2_eeprom_read(data_buf) != 0) {
                 printf("cannot read from i2c device: %02x\n", R2_EEPROM_AT24HC04B_U38_I2C_ADDR);
                 return 1;
         }
@@ -81,6 +93,54 @@ static int dump_roach2_eeprom(void)
         return 0;
 }
 
+/**** Deferred init ****/
+
+extern int sensors_config(void);
+
+static struct {
+  const char *name;
+  int (*init)(void);
+} r2_init_steps[R2_INIT_COUNT] = {
+  [R2_INIT_SENSORS] = {"sensors", sensors_config},
+  [R2_INIT_EEPROM]  = {"eeprom", dump_roach2_eeprom},
+};
+
+static u32 r2_init_done;
+static int r2_fast;
+
+int r2_fastboot(void)
+{
+  return r2_fast;
+}
+
+int r2_init_need(int step)
+{
+  if (r2_init_done & (1 << step))
+    return 0;
+  /* marked first: a failed step is not retried on every use */
+  r2_init_done |= 1 << step;
+  bootstage_mark(r2_init_steps[step].name, 0);
+  return r2_init_steps[step].init();
+}
+
+u32 r2_init_pending(void)
+{
+  return ~r2_init_done & ((1 << R2_INIT_COUNT) - 1);
+}
+
+/*
+ * Fast boot is selected with env fastboot=1 or, without that variable,
+ * by the cpld fast boot dip switch; fastboot=0 overrides the switch.
+ */
+static int roach2_fastboot_selected(int cpld_ok, int dips)
+{
+  char *s = getenv("fastboot");
+
+  if (s)
+    return *s == '1' || *s == 'y';
+  return cpld_ok && !(dips & CPLD_DIPS_FASTBOOT);
+}
+
 int board_early_init_f(void)
 {
   u32 sdr0_pfc1, sdr0_pfc2;
@@ -159,6 +219,10 @@ int misc_init_r(void)
   unsigned long sdr0_pfc1;
   u32 reg;
   int major, minor;
+  int dips = 0;
+#ifdef CONFIG_CMD_R2EBC
+  char *s;
+#endif
 
   mtdcr(EBC0_CFGADDR, EBC0_CFG);
 
@@ -224,21 +288,31 @@ int misc_init_r(void)
   mtebc(PB3AP, CONFIG_SYS_EBC_PB3AP);
   mtebc(PB3CR, CONFIG_SYS_EBC_PB3CR);
 #endif
+
+#ifdef CONFIG_CMD_R2EBC
+  /* fpga timing found by 'r2ebc tune' */
+  if ((s = getenv("ebc_pb1ap")) != NULL) {
+    debug("ebc: cs1 [fpga]  ap=%s (tuned)\n", s);
+    mtebc(PB1AP, simple_strtoul(s, NULL, 16));
+  }
+#endif
   /*
    * Re-check to get correct base address
    */
+  bootstage_mark("roach2: flash", 0);
   flash_get_size(gd->bd->bi_flashstart, 0);
 
+  bootstage_mark("roach2: cpld", 0);
+
 	major = *((unsigned char*)(CONFIG_SYS_CPLD_BASE + CPLD_REG_MAJOR));
 	minor = *((unsigned char*)(CONFIG_SYS_CPLD_BASE + CPLD_REG_MINOR));
 
 
   if (major > 0) { /* if CPLD programmed */
 	  printf("CPLD:  %d.%d\n", major, minor);
-    int dips;
     /* read dip switches */
 	  dips = *((unsigned char*)(CONFIG_SYS_CPLD_BASE + CPLD_REG_DIPS));
-    if (!(dips & 0x80)) {
+    if (!(dips & CPLD_DIPS_UART1)) {
 	    printf("UART1: assigning as console default\n");
       if (serial_assign("eserial1")) {
 	      printf("warning: failed to assign uart to RS232\n");
@@ -253,6 +327,10 @@ int misc_init_r(void)
   } else {
 	  printf("CPLD:  unprogrammed\n");
   }
+
+  r2_fast = roach2_fastboot_selected(major > 0, dips);
+  if (r2_fast)
+    printf("Boot:  fast, sensor/eeprom init deferred\n");
  
 #ifdef CONFIG_ENV_IS_IN_FLASH
   /* Monitor protection ON by default */
@@ -320,6 +398,7 @@ int misc_init_r(void)
   mtsdr(SDR0_USB2D0CR, usb2d0cr);
   mtsdr(SDR0_USB2PHY0CR, usb2phy0cr);
   mtsdr(SDR0_USB2H0CR, usb2h0cr);
+*/
   /* TODO: check reset scheme board/lwmon5/lwmon5.c has another take */
 
   /*clear resets*/
@@ -336,7 +415,9 @@ int misc_init_r(void)
   mtsdr(SDR0_SRST1, reg);
 
   /* TODO:Setting eeprom */
-  dump_roach2_eeprom();
+  /* the eeprom supplies ethaddr when none is set, needed before eth init */
+  if (!r2_fast || getenv("ethaddr") == NULL)
+    r2_init_need(R2_INIT_EEPROM);
 
   /*
    * Clear PLB4A0_ACR[WRP]
@@ -349,6 +430,17 @@ int misc_init_r(void)
   return 0;
 }
 
+#ifdef CONFIG_ROACH2_V6GBE
+extern int v6gbe_eth_initialize(bd_t *bis);
+
+int board_eth_init(bd_t *bis)
+{
+  /* the on-chip EMAC first so it keeps eth0/ethaddr */
+  cpu_eth_init(bis);
+  return v6gbe_eth_initialize(bis);
+}
+#endif
+
 int checkboard(void)
 {
   char *s = getenv("serial#");
@@ -415,11 +507,183 @@ int testdram(void)
 #endif
 
 
-#ifdef CONFIG_LAST_STAGE_INIT
-extern int sensors_config(void);
+#ifdef CONFIG_SHOW_ACTIVITY
+extern int thermal_poll(void);
+
+/* called with arg 0 while the console waits and 1 from the net loop */
+void show_activity(int arg)
+{
+  /* waiting for input, boot is over: finish a deferred sensor setup */
+  if (arg == 0)
+    r2_init_need(R2_INIT_SENSORS);
+  thermal_poll();
+}
+#endif
 
+#ifdef CONFIG_LAST_STAGE_INIT
 int last_stage_init()
 {
-  return sensors_config();
+  if (r2_fast)
+    return 0;
+  return r2_init_need(R2_INIT_SENSORS);
 }
 #endif
+
+#if defined(CONFIG_OF_LIBFDT) && defined(CONFIG_OF_BOARD_SETUP)
+extern void __ft_board_setup(void *blob, bd_t *bd);
+
+/*
+ * Board inventory under /roach2, so that Linux need not probe the
+ * eeprom, cpld and fpga again over i2c and the ebc:
+ *   eeprom: serial (as shown at boot), revision <major minor>, mac-address
+ *   cpld:   version <major minor>, dips
+ *   fpga:   bsp-revision <major minor rcs>, and bitstream-crc while the
+ *           image recorded in smapcrc is still loaded
+ *   qdrN:   taps, the per-bit delay taps stored by the qdr calibration,
+ *           when they were found for the loaded bsp revision
+ */
+static int ft_roach2_node(void *blob, int parent, const char *name)
+{
+  int node = fdt_subnode_offset(blob, parent, name);
+
+  if (node < 0)
+    node = fdt_add_subnode(blob, parent, name);
+  return node;
+}
+
+static int ft_roach2_cells(void *blob, int node, const char *name, const u32 *val, int n)
+{
+  u32 cells[3];
+  int i;
+
+  for (i = 0; i < n; i++)
+    cells[i] = cpu_to_fdt32(val[i]);
+  return fdt_setprop(blob, node, name, cells, n * sizeof(u32));
+}
+
+static int ft_roach2_eeprom(void *blob, int root)
+{
+  u8 data_buf[R2_EEPROM_AT24HC04B_SERIAL_LEN];
+  uchar mac[6];
+  char serial[32];
+  u32 rev[2];
+  int node;
+
+  if (roach2_eeprom_read(data_buf) != 0 || data_buf[0] == 0xFF)
+    return -1;
+  if ((node = ft_roach2_node(blob, root, "eeprom")) < 0)
+    return node;
+
+  sprintf(serial, "%c#%d#%d", data_buf[0], data_buf[3], data_buf[4]);
+  rev[0] = data_buf[1] + 1;
+  rev[1] = data_buf[2];
+  fdt_setprop_string(blob, node, "serial", serial);
+  ft_roach2_cells(blob, node, "revision", rev, 2);
+  if (eth_getenv_enetaddr("ethaddr", mac))
+    fdt_setprop(blob, node, "mac-address", mac, 6);
+  return 0;
+}
+
+static void ft_roach2_cpld(void *blob, int root)
+{
+  u32 ver[2];
+  int node;
+
+  ver[0] = *((unsigned char*)(CONFIG_SYS_CPLD_BASE + CPLD_REG_MAJOR));
+  ver[1] = *((unsigned char*)(CONFIG_SYS_CPLD_BASE + CPLD_REG_MINOR));
+  if (ver[0] == 0 || (node = ft_roach2_node(blob, root, "cpld")) < 0)
+    return;
+
+  ft_roach2_cells(blob, node, "version", ver, 2);
+  fdt_setprop_cell(blob, node, "dips",
+                   *((unsigned char*)(CONFIG_SYS_CPLD_BASE + CPLD_REG_DIPS)));
+}
+
+/* taps from env qdr<which>cal, "<bsp revision>:<36 hex tap values>" */
+static void ft_roach2_qdr(void *blob, int root, int which, const char *key)
+{
+  char name[8], hex[3];
+  u8 taps[36];
+  char *s;
+  int i, klen = strlen(key), node;
+
+  sprintf(name, "qdr%dcal", which);
+  if ((s = getenv(name)) == NULL || strncmp(s, key, klen) ||
+      s[klen] != ':' || strlen(s + klen + 1) != 2 * sizeof(taps))
+    return;
+
+  s += klen + 1;
+  for (i = 0; i < sizeof(taps); i++) {
+    hex[0] = s[2*i];
+    hex[1] = s[2*i + 1];
+    hex[2] = '\0';
+    taps[i] = simple_strtoul(hex, NULL, 16);
+  }
+
+  sprintf(name, "qdr%d", which);
+  if ((node = ft_roach2_node(blob, root, name)) < 0)
+    return;
+  fdt_setprop(blob, node, "taps", taps, sizeof(taps));
+}
+
+static void ft_roach2_fpga(void *blob, int root)
+{
+  u32 offset = CONFIG_SYS_FPGA_BASE;
+  u32 rev[3], crc;
+  char key[32];
+  char *s;
+  int node, i;
+
+  /* without a configured fpga the chip select only times out */
+  if (!gpio_read_in_bit(GPIO_SMAP_DONE) ||
+      *((volatile u32 *)(offset + BSP_REG_BOARDID)) != BSP_BOARDID)
+    return;
+  if ((node = ft_roach2_node(blob, root, "fpga")) < 0)
+    return;
+
+  rev[0] = *((volatile u32 *)(offset + BSP_REG_REVMAJ));
+  rev[1] = *((volatile u32 *)(offset + BSP_REG_REVMIN));
+  rev[2] = *((volatile u32 *)(offset + BSP_REG_REVRCS));
+  ft_roach2_cells(blob, node, "bsp-revision", rev, 3);
+
+  if ((s = getenv("smapcrc")) != NULL) {
+    crc = simple_strtoul(s, NULL, 16);
+    if (*((volatile u32 *)(offset + BSP_REG_SCRATCH(SMAP_CRC_SCRATCH))) == crc)
+      fdt_setprop_cell(blob, node, "bitstream-crc", crc);
+  }
+
+  /* same key as the qdr calibration store */
+  sprintf(key, "%x.%x.%x", rev[0], rev[1], rev[2]);
+  for (i = 0; i < 4; i++)
+    ft_roach2_qdr(blob, root, i, key);
+}
+
+void ft_board_setup(void *blob, bd_t *bd)
+{
+  char names[64];
+  int i, len = 0;
+  int root;
+
+  __ft_board_setup(blob, bd);
+
+  root = ft_roach2_node(blob, 0, "roach2");
+  if (root < 0) {
+    printf("WARNING: could not add /roach2 to the device tree: %s\n",
+           fdt_strerror(root));
+  } else {
+    /* the eeprom contents are handed over instead of the deferred dump */
+    if (ft_roach2_eeprom(blob, root) == 0)
+      r2_init_done |= 1 << R2_INIT_EEPROM;
+    ft_roach2_cpld(blob, root);
+    ft_roach2_fpga(blob, root);
+  }
+
+  /* tell linux which board init was never run */
+  for (i = 0; i < R2_INIT_COUNT; i++) {
+    if (r2_init_pending() & (1 << i))
+      len += sprintf(names + len, "%s", r2_init_steps[i].name) + 1;
+  }
+  if (len)
+    fdt_find_and_setprop(blob, "/chosen", "kat,roach2-deferred-init", names, len, 1);
+}
+#endif /* defined(CONFIG_OF_LIBFDT) && defined(CONFIG_OF_BOARD_SETUP) */
@@ -32,6 +32,7 @@
 #include <asm/processor.h>
 #include <asm/io.h>
 #include <asm/ppc440.h>
+#include <bootstage.h>
 
 /*-----------------------------------------------------------------------------+
  * Prototypes
@@ -98,6 +99,7 @@ phys_size_t initdram (int board_type)
 	mtsdram(DDR0_44, 0x00000002);
 	mtsdram(DDR0_02, 0x00000001);
 
+	bootstage_mark("ddr2: dll lock", 0);
 	denali_wait_for_dlllock();
 #endif /* #ifndef CONFIG_NAND_U_BOOT */
 
@@ -105,6 +107,7 @@ phys_size_t initdram (int board_type)
 	/* -----------------------------------------------------------+
 	 * Perform data eye search if requested.
 	 * ----------------------------------------------------------*/
+	bootstage_mark("ddr2: data eye", 0);
 	denali_core_search_data_eye();
 #endif
 #if defined(CONFIG_DRAM_TEST)
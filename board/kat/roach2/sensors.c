@@ -141,6 +141,88 @@ static int sensor_get_reg(u8 addr, u8 reg)
   return buffer[0];
 }
 
+struct r2_sensor_snapshot sensor_snap;
+
+const u8 snap_ambient_addr[SNAP_AMBIENT_COUNT] = {
+  R2_SENSOR_AD7414_U15_I2C_ADDR, R2_SENSOR_AD7414_U18_I2C_ADDR,
+};
+
+const u8 snap_fan_addr[SNAP_FAN_COUNT] = {
+  R2_SENSOR_MAX6650_U13_I2C_ADDR, R2_SENSOR_MAX6650_U17_I2C_ADDR,
+  R2_SENSOR_MAX6650_U21_I2C_ADDR, R2_SENSOR_MAX6650_U26_I2C_ADDR,
+};
+
+static int sensor_get_block(u8 addr, u8 reg, u8 *buf, int len)
+{
+  if (i2c_read(addr, reg, 1, buf, len) != 0) {
+    printf("cannot read from i2c device: %02x\n", addr);
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * Read every monitor once into snap. Banks that fail are left out of
+ * snap->valid; returns the number of failed banks.
+ */
+int sensors_snapshot(struct r2_sensor_snapshot *snap)
+{
+  int fail = 0;
+  int i, val;
+
+  snap->stamp = get_timer(0);
+  snap->valid = 0;
+
+  if (sensor_get_block(R2_VMON_IIC_ADDR, 0, snap->max16071[VMON], SNAP_MAX16071_LEN) == 0)
+    snap->valid |= SNAP_VALID_VMON;
+  else
+    fail++;
+
+  if (sensor_get_block(R2_CMON_IIC_ADDR, 0, snap->max16071[CMON], SNAP_MAX16071_LEN) == 0)
+    snap->valid |= SNAP_VALID_CMON;
+  else
+    fail++;
+
+  for (i = 0; i < SNAP_AMBIENT_COUNT; i++) {
+    if (sensor_get_block(snap_ambient_addr[i], R2_SENSOR_AD7414_TV, snap->ambient[i], 2) == 0)
+      snap->valid |= SNAP_VALID_AMBIENT0 << i;
+    else
+      fail++;
+  }
+
+  do {
+    if ((val = sensor_get_reg(R2_SENSOR_MAX1805_U22_I2C_ADDR, R2_SENSOR_MAX1805_TEMP_DX1)) < 0)
+      break;
+    snap->remote[0] = val;
+    if ((val = sensor_get_reg(R2_SENSOR_MAX1805_U22_I2C_ADDR, R2_SENSOR_MAX1805_TEMP_DX2)) < 0)
+      break;
+    snap->remote[1] = val;
+    if ((val = sensor_get_reg(R2_SENSOR_MAX1805_U22_I2C_ADDR, R2_SENSOR_MAX1805_TEMP_RS2)) < 0)
+      break;
+    snap->remote_status = val;
+    snap->valid |= SNAP_VALID_REMOTE;
+  } while (0);
+  if (!(snap->valid & SNAP_VALID_REMOTE))
+    fail++;
+
+  for (i = 0; i < SNAP_FAN_COUNT; i++) {
+    if ((val = sensor_get_reg(snap_fan_addr[i], R2_SENSOR_MAX6650_TACH0)) < 0) {
+      fail++;
+      continue;
+    }
+    snap->fan_tach[i] = val;
+    if ((val = sensor_get_reg(snap_fan_addr[i], R2_SENSOR_MAX6650_ALARMST)) < 0) {
+      fail++;
+      continue;
+    }
+    snap->fan_alarm[i] = val;
+    snap->valid |= SNAP_VALID_FAN0 << i;
+  }
+
+  snap->elapsed = get_timer(snap->stamp);
+  return fail;
+}
+
 int max16071_config(int addr, struct max16071_config* maxc)
 {
   int i;
@@ -352,6 +434,88 @@ int sensors_config(void)
     printf("max6650: chs2 config failed\n");
     fail = 1;
   }
-  
+
+  /* the fpga fan is back at its boot speed, whatever the loop had set */
+  thermal_reset();
+
   return fail;
 }
+
+#ifdef CONFIG_ROACH2_THERMAL
+/*
+ * Closed loop thermal control, called from the console idle loop, the
+ * net loop and long running loops (selectmap loads, BITs). At most
+ * every THERMAL_POLL_MS the max1805 remote temperatures are sampled and
+ * the fpga fan target is set from the hotter of the two. Returns
+ * non-zero while either is at or above THERMAL_T_CRIT so the caller can
+ * abort. With env thermal=off the fans keep their boot configuration.
+ */
+static struct {
+  ulong last;   /* get_timer() of the last sample */
+  int speed;    /* last speed written, -1 for none */
+  int crit;     /* over temperature at the last sample */
+  int temp[2];  /* ppc and fpga temperatures at the last sample */
+} thermal = { .speed = -1 };
+
+static int thermal_fan_speed(int t)
+{
+  if (t <= THERMAL_T_QUIET)
+    return THERMAL_FAN_QUIET;
+  if (t >= THERMAL_T_FULL)
+    return THERMAL_FAN_FULL;
+  return THERMAL_FAN_QUIET - ((THERMAL_FAN_QUIET - THERMAL_FAN_FULL) *
+                              (t - THERMAL_T_QUIET)) / (THERMAL_T_FULL - THERMAL_T_QUIET);
+}
+
+/* forget the fan speed written, the next poll samples and sets it again */
+void thermal_reset(void)
+{
+  thermal.speed = -1;
+  thermal.last = 0;
+}
+
+int thermal_poll(void)
+{
+  char *s;
+  u8 val;
+  int i, t, speed;
+
+  if (thermal.last && get_timer(thermal.last) < THERMAL_POLL_MS)
+    return thermal.crit;
+  thermal.last = get_timer(0);
+
+  s = getenv("thermal");
+  if (s && !strcmp(s, "off"))
+    return thermal.crit = 0;
+
+  /* quietly: a missing sample must not flood the console */
+  t = 0;
+  for (i = 0; i < 2; i++) {
+    if (i2c_read(R2_SENSOR_MAX1805_U22_I2C_ADDR,
+                 i ? R2_SENSOR_MAX1805_TEMP_DX2 : R2_SENSOR_MAX1805_TEMP_DX1,
+                 1, &val, 1) != 0)
+      return thermal.crit;
+    /* the registers are two's complement */
+    thermal.temp[i] = (s8)val;
+    if (thermal.temp[i] > t)
+      t = thermal.temp[i];
+  }
+
+  speed = thermal_fan_speed(t);
+  if (speed != thermal.speed) {
+    val = speed;
+    if (i2c_write(R2_SENSOR_MAX6650_U13_I2C_ADDR, R2_SENSOR_MAX6650_SPEED, 1, &val, 1) == 0)
+      thermal.speed = speed;
+  }
+
+  if (t >= THERMAL_T_CRIT) {
+    if (!thermal.crit)
+      printf("\nerror: over temperature, ppc %d dC, fpga %d dC\n",
+             thermal.temp[0], thermal.temp[1]);
+    thermal.crit = 1;
+  } else {
+    thermal.crit = 0;
+  }
+  return thermal.crit;
+}
+#endif /* CONFIG_ROACH2_THERMAL */
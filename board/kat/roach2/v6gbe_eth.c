@@ -0,0 +1,151 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * Ethernet driver for the 1GbE core in the ROACH2 BSP gateware. The
+ * core exposes one transmit and one receive frame buffer on the FPGA
+ * chip select; writing TXSIZE sends the transmit buffer and a non-zero
+ * RXSIZE flags a received frame until it is written back to zero.
+ * The port is only usable once a BSP image is loaded, which is
+ * checked each time the device is brought up.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <net.h>
+
+#include <asm/processor.h>
+#include <asm/ppc4xx.h>
+#include <asm/ppc4xx-gpio.h>
+
+#include "include/fpga.h"
+#include "include/smap.h"
+
+#ifdef CONFIG_ROACH2_V6GBE
+
+#define V6GBE_BASE (CONFIG_SYS_FPGA_BASE + BSP_GBE_OFFSET)
+
+/* the core has no jumbo support: largest frame it buffers, without the fcs */
+#define V6GBE_MTU       1500
+#define V6GBE_MAX_FRAME (ETHER_HDR_SIZE + V6GBE_MTU)
+
+static void v6gbe_eth_set_short(u32 reg, u16 data)
+{
+  *((volatile u16 *)(V6GBE_BASE + BSP_GBE_REG_OFFSET + reg)) = data;
+}
+
+static u16 v6gbe_eth_get_short(u32 reg)
+{
+  return *((volatile u16 *)(V6GBE_BASE + BSP_GBE_REG_OFFSET + reg));
+}
+
+static int v6gbe_eth_init(struct eth_device *dev, bd_t *bis)
+{
+  /* without a configured fpga the chip select only times out */
+  if (!gpio_read_in_bit(GPIO_SMAP_DONE) ||
+      *((volatile u32 *)(CONFIG_SYS_FPGA_BASE + BSP_REG_BOARDID)) != BSP_BOARDID) {
+    printf("%s: fpga not configured with a BSP image\n", dev->name);
+    return -1;
+  }
+
+  if (!v6gbe_eth_get_short(BSP_GBE_REG_STLINK)) {
+    printf("%s: sgmii link down\n", dev->name);
+    return -1;
+  }
+
+  /*
+   * The core does no address filtering of its own. eth_init() has
+   * already loaded eth1addr when it is set; without one an address is
+   * derived from the current ethaddr. A vendor ethaddr gets the locally
+   * administered bit. The one made up from the serial number already
+   * has it (02:...), so another bit of the first octet is flipped
+   * (06:...), which no derived EMAC address uses.
+   */
+  if (!eth_getenv_enetaddr("eth1addr", dev->enetaddr) &&
+      eth_getenv_enetaddr("ethaddr", dev->enetaddr)) {
+    if (dev->enetaddr[0] & 0x02)
+      dev->enetaddr[0] ^= 0x04;
+    else
+      dev->enetaddr[0] |= 0x02;
+  }
+
+  /* drop anything left in the receive buffer */
+  v6gbe_eth_set_short(BSP_GBE_REG_RXSIZE, 0);
+  return 0;
+}
+
+static int v6gbe_eth_send(struct eth_device *dev, volatile void *packet, int length)
+{
+  if (length > V6GBE_MAX_FRAME) {
+    printf("%s: frame of %d bytes too long\n", dev->name, length);
+    return -1;
+  }
+
+  memcpy((void *)(V6GBE_BASE + BSP_GBE_TX_OFFSET), (void *)packet, length);
+  v6gbe_eth_set_short(BSP_GBE_REG_TXSIZE, length);
+  return 0;
+}
+
+static int v6gbe_eth_recv(struct eth_device *dev)
+{
+  u16 rxsize;
+
+  rxsize = v6gbe_eth_get_short(BSP_GBE_REG_RXSIZE);
+  if (rxsize == 0)
+    return 0;
+
+  if (rxsize <= ETHER_HDR_SIZE || rxsize > V6GBE_MAX_FRAME) {
+    v6gbe_eth_set_short(BSP_GBE_REG_RXSIZE, 0);
+    return -1;
+  }
+
+  memcpy((void *)NetRxPackets[0], (void *)(V6GBE_BASE + BSP_GBE_RX_OFFSET), rxsize);
+
+  /* ack the buffer before handing the frame up, replies may follow */
+  v6gbe_eth_set_short(BSP_GBE_REG_RXSIZE, 0);
+
+  NetReceive(NetRxPackets[0], rxsize);
+  return rxsize;
+}
+
+static void v6gbe_eth_halt(struct eth_device *dev)
+{
+}
+
+int v6gbe_eth_initialize(bd_t *bis)
+{
+  struct eth_device *dev;
+
+  dev = malloc(sizeof(*dev));
+  if (dev == NULL)
+    return -1;
+  memset(dev, 0, sizeof(*dev));
+
+  sprintf(dev->name, "v6gbe");
+  dev->iobase = V6GBE_BASE;
+  dev->init = v6gbe_eth_init;
+  dev->send = v6gbe_eth_send;
+  dev->recv = v6gbe_eth_recv;
+  dev->halt = v6gbe_eth_halt;
+#ifdef CONFIG_NET_MTU
+  dev->mtu = V6GBE_MTU;
+#endif
+
+  return eth_register(dev);
+}
+
+#endif /* CONFIG_ROACH2_V6GBE */
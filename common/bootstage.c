@@ -0,0 +1,145 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+/*
+ * Boot stage recorder. Stamps live in the global data so that the
+ * ones taken while running from flash are carried over by the copy
+ * made at relocation. Each stamp marks the start of its stage.
+ */
+
+#include <common.h>
+#include <command.h>
+#include <div64.h>
+#include <bootstage.h>
+#ifdef CONFIG_OF_LIBFDT
+#include <libfdt.h>
+#endif
+
+DECLARE_GLOBAL_DATA_PTR;
+
+void bootstage_mark(const char *name, ulong id)
+{
+	unsigned int n = gd->bootstage_count;
+	unsigned long long now;
+
+	if (n >= CONFIG_BOOTSTAGE_MAX) {
+		if (!gd->bootstage_dropped++)
+			printf("WARNING: bootstage table full, "
+			       "raise CONFIG_BOOTSTAGE_MAX (%d)\n",
+			       CONFIG_BOOTSTAGE_MAX);
+		return;
+	}
+
+	/*
+	 * init_timebase() restarts the timebase from zero; carry on from
+	 * the last stamp, losing only the time since it was taken.
+	 */
+	now = get_ticks() + gd->bootstage_offset;
+	if (n && now < gd->bootstage[n - 1].stamp) {
+		gd->bootstage_offset = gd->bootstage[n - 1].stamp;
+		now = get_ticks() + gd->bootstage_offset;
+	}
+
+	gd->bootstage[n].name = name;
+	gd->bootstage[n].id = id;
+	gd->bootstage[n].stamp = now;
+	gd->bootstage_count = n + 1;
+}
+
+static ulong bootstage_us(unsigned long long ticks)
+{
+	return lldiv(ticks * 1000000, get_tbclk());
+}
+
+static void bootstage_name(unsigned int i, char *buf)
+{
+	if (gd->bootstage[i].name)
+		strcpy(buf, gd->bootstage[i].name);
+	else
+		sprintf(buf, "init@%08lx", gd->bootstage[i].id);
+}
+
+#ifdef CONFIG_OF_LIBFDT
+/*
+ * Add a /bootstage node with one subnode per stamp, each holding the
+ * stage name and its start in microseconds since reset.
+ */
+int bootstage_fdt(void *blob)
+{
+	char name[32];
+	int root, node, i;
+
+	bootstage_mark("fdt", 0);
+
+	root = fdt_path_offset(blob, "/bootstage");
+	if (root >= 0)
+		fdt_del_node(blob, root);
+	root = fdt_add_subnode(blob, 0, "bootstage");
+	if (root < 0)
+		goto err;
+	if (gd->bootstage_dropped &&
+	    fdt_setprop_cell(blob, root, "dropped", gd->bootstage_dropped) < 0)
+		goto err;
+
+	/* added in reverse so that they read in boot order */
+	for (i = (int)gd->bootstage_count - 1; i >= 0; i--) {
+		sprintf(name, "%d", i);
+		node = fdt_add_subnode(blob, root, name);
+		if (node < 0)
+			goto err;
+		bootstage_name(i, name);
+		if (fdt_setprop_string(blob, node, "name", name) < 0 ||
+		    fdt_setprop_cell(blob, node, "mark",
+				     bootstage_us(gd->bootstage[i].stamp)) < 0)
+			goto err;
+	}
+	return 0;
+
+err:
+	printf("WARNING: could not add /bootstage to the device tree\n");
+	return -1;
+}
+#endif
+
+static int do_bootstage(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	char name[32];
+	unsigned long long prev = 0;
+	unsigned int i;
+
+	printf("%-24s %12s %12s\n", "stage", "start (us)", "delta (us)");
+	for (i = 0; i < gd->bootstage_count; i++) {
+		bootstage_name(i, name);
+		printf("%-24s %12lu %12lu\n", name,
+		       bootstage_us(gd->bootstage[i].stamp),
+		       bootstage_us(gd->bootstage[i].stamp - prev));
+		prev = gd->bootstage[i].stamp;
+	}
+	printf("%-24s %12lu\n", "now",
+	       bootstage_us(get_ticks() + gd->bootstage_offset));
+
+	if (gd->bootstage_dropped)
+		printf("(table full, %u later stages were dropped)\n",
+		       gd->bootstage_dropped);
+	return 0;
+}
+
+U_BOOT_CMD(
+	bootstage,	1,	1,	do_bootstage,
+	"show boot stage timing",
+	"- list the recorded boot stages with their start times"
+);
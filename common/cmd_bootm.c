@@ -41,6 +41,10 @@
 #include <usb.h>
 #endif
 
+#ifdef CONFIG_NET_KEEP_LINK
+#include <net.h>
+#endif
+
 #ifdef CONFIG_SYS_HUSH_PARSER
 #include <hush.h>
 #endif
@@ -571,6 +575,9 @@ int do_bootm_subcommand (cmd_tbl_t *cmdtp, int flag, int argc, char * const argv
 			break;
 		case BOOTM_STATE_OS_GO:
 			disable_interrupts();
+#ifdef CONFIG_NET_KEEP_LINK
+			eth_halt_all();
+#endif
 			arch_preboot_os();
 			boot_fn(BOOTM_STATE_OS_GO, argc, argv, &images);
 			break;
@@ -642,6 +649,11 @@ int do_bootm (cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 	usb_stop();
 #endif
 
+#ifdef CONFIG_NET_KEEP_LINK
+	/* a parked ethernet device still owns its DMA rings */
+	eth_halt_all();
+#endif
+
 	ret = bootm_load_os(images.os, &load_end, 1);
 
 	if (ret < 0) {
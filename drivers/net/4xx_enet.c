@@ -112,6 +112,16 @@
 #define ENET_MAX_MTU	       PKTSIZE
 #define ENET_MAX_MTU_ALIGNED   PKTSIZE_ALIGN
 
+/* ring buffer of receive descriptor i, see ppc_4xx_eth_init() */
+#define ENET_RX_BUF(i)	((char *)NetRxPackets[0] + (i) * MAL_BUF_SIZE)
+
+#ifdef CONFIG_NET_RX_PLACE
+/* the EMAC strips the fcs, so placed payload ends where it belongs */
+#define ENET_RX_FCS	0
+#else
+#define ENET_RX_FCS	4
+#endif
+
 /*-----------------------------------------------------------------------------+
  * Defines for MAL/EMAC interrupt conditions as reported in the UIC (Universal
  * Interrupt Controller).
@@ -293,6 +303,15 @@ static const struct fixed_phy_port fixed_phy_port[] = {
 #define MAL_TX_DESC_SIZE	2048
 #define MAL_ALLOC_SIZE		(MAL_TX_DESC_SIZE + MAL_RX_DESC_SIZE)
 
+#if NUM_RX_DESC * 8 > MAL_RX_DESC_SIZE
+#error "too many MAL receive descriptors, reduce CONFIG_SYS_RX_ETH_BUFFER"
+#endif
+
+#if MAL_BUF_PER_PKT > 1
+/* frames whose buffers are not back to back are copied here */
+static uchar enet_rx_bounce[PKTSIZE_ALIGN] __attribute__((aligned(PKTALIGN)));
+#endif
+
 /*-----------------------------------------------------------------------------+
  * Prototypes and externals.
  *-----------------------------------------------------------------------------*/
@@ -303,6 +322,9 @@ static void mal_err (struct eth_device *dev, unsigned long isr,
 		     unsigned long uic, unsigned long maldef,
 		     unsigned long mal_errr);
 static void emac_err (struct eth_device *dev, unsigned long isr);
+#ifdef CONFIG_NET_KEEP_LINK
+static int ppc_4xx_eth_resume (struct eth_device *dev);
+#endif
 
 extern int phy_setup_aneg (char *devname, unsigned char addr);
 extern int emac4xx_miiphy_read (const char *devname, unsigned char addr,
@@ -390,6 +412,9 @@ static void ppc_4xx_eth_halt (struct eth_device *dev)
 #ifndef CONFIG_NETCONSOLE
 	hw_p->print_speed = 1;	/* print speed message again next time */
 #endif
+#ifdef CONFIG_NET_KEEP_LINK
+	hw_p->parked = 0;
+#endif
 
 #if defined(CONFIG_460EX) || defined(CONFIG_460GT)
 	/* don't bypass the TAHOE0/TAHOE1 cores for Linux */
@@ -899,6 +924,15 @@ static int ppc_4xx_eth_init (struct eth_device *dev, bd_t * bis)
 		return -1;
 	}
 
+#ifdef CONFIG_NET_KEEP_LINK
+	if (hw_p->parked) {
+		if (ppc_4xx_eth_resume(dev) == 0)
+			return 0;
+		/* the link went away or changed while parked */
+		ppc_4xx_eth_halt(dev);
+	}
+#endif
+
 #if defined(CONFIG_440GX) || \
     defined(CONFIG_440EPX) || defined(CONFIG_440GRX) || \
     defined(CONFIG_440SP) || defined(CONFIG_440SPE) || \
@@ -1239,6 +1273,10 @@ get_speed:
 			(int) speed, (duplex == HALF) ? "HALF" : "FULL",
 			hw_p->devnum);
 	}
+#ifdef CONFIG_NET_KEEP_LINK
+	hw_p->link_speed = speed;
+	hw_p->link_duplex = duplex;
+#endif
 
 #if defined(CONFIG_440) && \
     !defined(CONFIG_440SP) && !defined(CONFIG_440SPE) && \
@@ -1359,21 +1397,23 @@ get_speed:
 	for (i = 0; i < NUM_TX_BUFF; i++) {
 		hw_p->tx[i].ctrl = 0;
 		hw_p->tx[i].data_len = 0;
-		if (hw_p->first_init == 0)
-			hw_p->txbuf_ptr = malloc_aligned(MAL_ALLOC_SIZE,
+		if (hw_p->first_init == 0 && i == 0)
+			hw_p->txbuf_ptr = malloc_aligned(MAL_ALLOC_SIZE > ENET_MAX_MTU_ALIGNED ?
+							 MAL_ALLOC_SIZE : ENET_MAX_MTU_ALIGNED,
 							 L1_CACHE_BYTES);
-		hw_p->tx[i].data_ptr = hw_p->txbuf_ptr;
+		hw_p->tx[i].data_ptr = hw_p->txbuf_ptr + i * MAL_BUF_SIZE;
 		if ((NUM_TX_BUFF - 1) == i)
 			hw_p->tx[i].ctrl |= MAL_TX_CTRL_WRAP;
 		hw_p->tx_run[i] = -1;
 		debug("TX_BUFF %d @ 0x%08lx\n", i, (u32)hw_p->tx[i].data_ptr);
 	}
 
-	for (i = 0; i < NUM_RX_BUFF; i++) {
+	for (i = 0; i < NUM_RX_DESC; i++) {
 		hw_p->rx[i].ctrl = 0;
 		hw_p->rx[i].data_len = 0;
-		hw_p->rx[i].data_ptr = (char *)NetRxPackets[i];
-		if ((NUM_RX_BUFF - 1) == i)
+		/* NetRxPackets[] are contiguous, see NetLoop() */
+		hw_p->rx[i].data_ptr = ENET_RX_BUF(i);
+		if ((NUM_RX_DESC - 1) == i)
 			hw_p->rx[i].ctrl |= MAL_RX_CTRL_WRAP;
 		hw_p->rx[i].ctrl |= MAL_RX_CTRL_EMPTY | MAL_RX_CTRL_INTR;
 		hw_p->rx_ready[i] = -1;
@@ -1415,11 +1455,11 @@ get_speed:
 #if defined(CONFIG_460EX) || defined(CONFIG_460GT)
 		mtdcr (MAL0_RXCTP8R, hw_p->rx_phys);
 		/* set RX buffer size */
-		mtdcr (MAL0_RCBS8, ENET_MAX_MTU_ALIGNED / 16);
+		mtdcr (MAL0_RCBS8, MAL_BUF_SIZE / 16);
 #else
 		mtdcr (MAL0_RXCTP1R, hw_p->rx_phys);
 		/* set RX buffer size */
-		mtdcr (MAL0_RCBS1, ENET_MAX_MTU_ALIGNED / 16);
+		mtdcr (MAL0_RCBS1, MAL_BUF_SIZE / 16);
 #endif
 		break;
 #if defined (CONFIG_440GX)
@@ -1430,7 +1470,7 @@ get_speed:
 		mtdcr (MAL0_TXCTP2R, hw_p->tx_phys);
 		mtdcr (MAL0_RXCTP2R, hw_p->rx_phys);
 		/* set RX buffer size */
-		mtdcr (MAL0_RCBS2, ENET_MAX_MTU_ALIGNED / 16);
+		mtdcr (MAL0_RCBS2, MAL_BUF_SIZE / 16);
 		break;
 	case 3:
 		/* setup MAL tx & rx channel pointers */
@@ -1439,7 +1479,7 @@ get_speed:
 		mtdcr (MAL0_RXBADDR, 0x0);
 		mtdcr (MAL0_RXCTP3R, hw_p->rx_phys);
 		/* set RX buffer size */
-		mtdcr (MAL0_RCBS3, ENET_MAX_MTU_ALIGNED / 16);
+		mtdcr (MAL0_RCBS3, MAL_BUF_SIZE / 16);
 		break;
 #endif /* CONFIG_440GX */
 #if defined (CONFIG_460GT)
@@ -1450,7 +1490,7 @@ get_speed:
 		mtdcr (MAL0_TXCTP2R, hw_p->tx_phys);
 		mtdcr (MAL0_RXCTP16R, hw_p->rx_phys);
 		/* set RX buffer size */
-		mtdcr (MAL0_RCBS16, ENET_MAX_MTU_ALIGNED / 16);
+		mtdcr (MAL0_RCBS16, MAL_BUF_SIZE / 16);
 		break;
 	case 3:
 		/* setup MAL tx & rx channel pointers */
@@ -1459,7 +1499,7 @@ get_speed:
 		mtdcr (MAL0_TXCTP3R, hw_p->tx_phys);
 		mtdcr (MAL0_RXCTP24R, hw_p->rx_phys);
 		/* set RX buffer size */
-		mtdcr (MAL0_RCBS24, ENET_MAX_MTU_ALIGNED / 16);
+		mtdcr (MAL0_RCBS24, MAL_BUF_SIZE / 16);
 		break;
 #endif /* CONFIG_460GT */
 	case 0:
@@ -1472,7 +1512,7 @@ get_speed:
 		mtdcr (MAL0_TXCTP0R, hw_p->tx_phys);
 		mtdcr (MAL0_RXCTP0R, hw_p->rx_phys);
 		/* set RX buffer size */
-		mtdcr (MAL0_RCBS0, ENET_MAX_MTU_ALIGNED / 16);
+		mtdcr (MAL0_RCBS0, MAL_BUF_SIZE / 16);
 		break;
 	}
 
@@ -1492,6 +1532,14 @@ get_speed:
 	/* set rx-/tx-fifo size */
 	mode_reg = (mode_reg & ~EMAC_MR1_FIFO_MASK) | EMAC_MR1_FIFO_SIZE;
 
+#if defined(EMAC_MR1_JUMBO_ENABLE)
+	/* accept and send frames longer than 1518 bytes */
+	if (ENET_MAX_MTU > 1518)
+		mode_reg |= EMAC_MR1_JUMBO_ENABLE;
+	else
+		mode_reg &= ~EMAC_MR1_JUMBO_ENABLE;
+#endif
+
 	/* set speed */
 	if (speed == _1000BASET) {
 #if defined(CONFIG_440SP) || defined(CONFIG_440SPE)
@@ -1513,7 +1561,12 @@ get_speed:
 
 	/* Enable broadcast and indvidual address */
 	/* TBS: enabling runts as some misbehaved nics will send runts */
+#ifdef CONFIG_NET_RX_PLACE
+	out_be32((void *)EMAC0_RXM + hw_p->hw_addr,
+		 EMAC_RMR_BAE | EMAC_RMR_IAE | EMAC_RMR_SFCS);
+#else
 	out_be32((void *)EMAC0_RXM + hw_p->hw_addr, EMAC_RMR_BAE | EMAC_RMR_IAE);
+#endif
 
 	/* we probably need to set the tx mode1 reg? maybe at tx time */
 
@@ -1567,6 +1620,7 @@ static int ppc_4xx_eth_send (struct eth_device *dev, volatile void *ptr,
 	ulong time_start, time_now;
 	unsigned long temp_txm0;
 	EMAC_4XX_HW_PST hw_p = dev->priv;
+	int i, n, slot;
 
 	ef_ptr = (struct enet_frame *) ptr;
 
@@ -1588,15 +1642,27 @@ static int ppc_4xx_eth_send (struct eth_device *dev, volatile void *ptr,
 
 	/*-----------------------------------------------------------------------+
 	 * set TX Buffer busy, and send it
+	 *
+	 * A jumbo frame takes several descriptors. The MAL walks the ring
+	 * in order, so each frame starts where the last one ended.
 	 *-----------------------------------------------------------------------*/
-	hw_p->tx[hw_p->tx_slot].ctrl = (MAL_TX_CTRL_LAST |
-					EMAC_TX_CTRL_GFCS | EMAC_TX_CTRL_GP) &
-		~(EMAC_TX_CTRL_ISA | EMAC_TX_CTRL_RSA);
-	if ((NUM_TX_BUFF - 1) == hw_p->tx_slot)
-		hw_p->tx[hw_p->tx_slot].ctrl |= MAL_TX_CTRL_WRAP;
-
-	hw_p->tx[hw_p->tx_slot].data_len = (short) len;
-	hw_p->tx[hw_p->tx_slot].ctrl |= MAL_TX_CTRL_READY;
+	n = (len + MAL_BUF_SIZE - 1) / MAL_BUF_SIZE;
+	for (i = 0; i < n; i++) {
+		slot = (hw_p->tx_slot + i) % NUM_TX_BUFF;
+		hw_p->tx[slot].ctrl = (EMAC_TX_CTRL_GFCS | EMAC_TX_CTRL_GP) &
+			~(EMAC_TX_CTRL_ISA | EMAC_TX_CTRL_RSA);
+		if (i == n - 1)
+			hw_p->tx[slot].ctrl |= MAL_TX_CTRL_LAST;
+		if ((NUM_TX_BUFF - 1) == slot)
+			hw_p->tx[slot].ctrl |= MAL_TX_CTRL_WRAP;
+
+		hw_p->tx[slot].data_ptr = hw_p->txbuf_ptr + i * MAL_BUF_SIZE;
+		hw_p->tx[slot].data_len = (short) (i == n - 1 ?
+						   len - i * MAL_BUF_SIZE :
+						   MAL_BUF_SIZE);
+		hw_p->tx[slot].ctrl |= MAL_TX_CTRL_READY;
+	}
+	hw_p->tx_slot = (hw_p->tx_slot + n) % NUM_TX_BUFF;
 
 	sync();
 
@@ -1773,13 +1839,12 @@ static void emac_err (struct eth_device *dev, unsigned long isr)
  *-----------------------------------------------------------------------------*/
 static void enet_rcv (struct eth_device *dev, unsigned long malisr)
 {
-	struct enet_frame *ef_ptr;
 	unsigned long data_len;
 	unsigned long rx_eob_isr;
 	EMAC_4XX_HW_PST hw_p = dev->priv;
 
 	int handled = 0;
-	int i;
+	int i, j, n, last;
 	int loop_count = 0;
 
 	rx_eob_isr = mfdcr (MAL0_RXEOBISR);
@@ -1792,21 +1857,48 @@ static void enet_rcv (struct eth_device *dev, unsigned long malisr)
 			i = hw_p->rx_slot;
 
 			if ((MAL_RX_CTRL_EMPTY & hw_p->rx[i].ctrl)
-			    || (loop_count >= NUM_RX_BUFF))
+			    || (loop_count >= NUM_RX_DESC))
 				break;
 
-			loop_count++;
-			handled++;
+			/*
+			 * A jumbo frame continues in the following
+			 * descriptors; leave it until its last one is in.
+			 */
+			last = i;
+			n = 1;
 			data_len = (unsigned long) hw_p->rx[i].data_len & 0x0fff;	/* Get len */
+			while (!(MAL_RX_CTRL_LAST & hw_p->rx[last].ctrl)) {
+				last = (last + 1) % NUM_RX_DESC;
+				if ((MAL_RX_CTRL_EMPTY & hw_p->rx[last].ctrl)
+				    || last == i) {
+					last = -1;
+					break;
+				}
+				data_len += hw_p->rx[last].data_len & 0x0fff;
+				n++;
+			}
+			if (last < 0)
+				break;
+
+			/* Check if user has already eaten buffer */
+			/* if not => ERROR */
+			if (hw_p->rx_ready[hw_p->rx_i_index] != -1) {
+				if (hw_p->is_receiving)
+					printf ("ERROR : Receive buffers are full!\n");
+				break;
+			}
+
+			loop_count += n;
+			handled++;
 			if (data_len) {
 				if (data_len > ENET_MAX_MTU)	/* Check len */
 					data_len = 0;
 				else {
-					if (EMAC_RX_ERRORS & hw_p->rx[i].ctrl) {	/* Check Errors */
+					if (EMAC_RX_ERRORS & hw_p->rx[last].ctrl) {	/* Check Errors */
 						data_len = 0;
 						hw_p->stats.rx_err_log[hw_p->
 								       rx_err_index]
-							= hw_p->rx[i].ctrl;
+							= hw_p->rx[last].ctrl;
 						hw_p->rx_err_index++;
 						if (hw_p->rx_err_index ==
 						    MAX_ERR_LOG)
@@ -1816,24 +1908,15 @@ static void enet_rcv (struct eth_device *dev, unsigned long malisr)
 				}	/* data_len < max mtu */
 			}	/* if data_len */
 			if (!data_len) {	/* no data */
-				hw_p->rx[i].ctrl |= MAL_RX_CTRL_EMPTY;	/* Free Recv Buffer */
+				/* Free Recv Buffers */
+				for (j = 0; j < n; j++)
+					hw_p->rx[(i + j) % NUM_RX_DESC].ctrl |=
+						MAL_RX_CTRL_EMPTY;
 
 				hw_p->stats.data_len_err++;	/* Error at Rx */
-			}
-
-			/* !data_len */
-			/* AS.HARNOIS */
-			/* Check if user has already eaten buffer */
-			/* if not => ERROR */
-			else if (hw_p->rx_ready[hw_p->rx_i_index] != -1) {
-				if (hw_p->is_receiving)
-					printf ("ERROR : Receive buffers are full!\n");
-				break;
 			} else {
 				hw_p->stats.rx_frames++;
 				hw_p->stats.rx += data_len;
-				ef_ptr = (struct enet_frame *) hw_p->rx[i].
-					data_ptr;
 #ifdef INFO_4XX_ENET
 				hw_p->stats.pkts_rx++;
 #endif
@@ -1841,29 +1924,148 @@ static void enet_rcv (struct eth_device *dev, unsigned long malisr)
 				 * use ring buffer
 				 */
 				hw_p->rx_ready[hw_p->rx_i_index] = i;
+				hw_p->rx_ready_len[hw_p->rx_i_index] = data_len;
 				hw_p->rx_i_index++;
-				if (NUM_RX_BUFF == hw_p->rx_i_index)
+				if (NUM_RX_DESC == hw_p->rx_i_index)
 					hw_p->rx_i_index = 0;
 
-				hw_p->rx_slot++;
-				if (NUM_RX_BUFF == hw_p->rx_slot)
-					hw_p->rx_slot = 0;
-
 				/*  AS.HARNOIS
 				 * free receive buffer only when
 				 * buffer has been handled (eth_rx)
 				 rx[i].ctrl |= MAL_RX_CTRL_EMPTY;
 				 */
 			}	/* if data_len */
+
+			hw_p->rx_slot = (last + 1) % NUM_RX_DESC;
 		}		/* while */
 	}			/* if EMACK_RXCHL */
 }
 
 
+/*
+ * Where the buffers of a received frame are: 0 back to back in the
+ * ring, 1 the first one in the ring and the rest placed back to back
+ * elsewhere, -1 anything else (wrapped around the ring, or received
+ * out of step with the placement), which has to be gathered.
+ */
+static int enet_rx_layout (EMAC_4XX_HW_PST hw_p, int first, int n)
+{
+	char *buf;
+	int i;
+
+	if (first + n > NUM_RX_DESC ||
+	    hw_p->rx[first].data_ptr != ENET_RX_BUF(first))
+		return -1;
+	if (n == 1)
+		return 0;
+
+	buf = hw_p->rx[first + 1].data_ptr;
+	for (i = 2; i < n; i++)
+		if (hw_p->rx[first + i].data_ptr != buf + (i - 1) * MAL_BUF_SIZE)
+			return -1;
+	return buf != ENET_RX_BUF(first + 1);
+}
+
+#if MAL_BUF_PER_PKT > 1
+static uchar *enet_rx_gather (EMAC_4XX_HW_PST hw_p, int first, int length)
+{
+	char *buf;
+	int i, n;
+
+	for (i = 0; i < length; i += n) {
+		buf = hw_p->rx[first].data_ptr;
+		n = length - i < MAL_BUF_SIZE ? length - i : MAL_BUF_SIZE;
+		invalidate_dcache_range((u32)buf, (u32)buf + n);
+		memcpy(enet_rx_bounce + i, buf, n);
+		first = (first + 1) % NUM_RX_DESC;
+	}
+	return enet_rx_bounce;
+}
+#endif
+
+#ifdef CONFIG_NET_RX_PLACE
+/*
+ * Arm the buffers the next count frames will be received into. The
+ * first buffer of each frame stays in the ring and takes the headers,
+ * the ones after it point into the frame's payload destination. The
+ * MAL may already be filling the first frame's worth of empty buffers,
+ * so those are left alone and the first frame is not placed. The MAL
+ * may fill a buffer whole, so a frame is only armed when its last
+ * buffer ends at or below end.
+ */
+static int ppc_4xx_eth_rx_place (struct eth_device *dev, uchar *dest,
+				 int hdrlen, int len, int count, uchar *end)
+{
+	EMAC_4XX_HW_PST hw_p = dev->priv;
+	int i, j, k, n, armed;
+
+	n = (hdrlen + len + MAL_BUF_SIZE - 1) / MAL_BUF_SIZE;
+
+	/* first buffer the MAL has not filled */
+	i = hw_p->rx_slot;
+	for (j = 0; !(hw_p->rx[i].ctrl & MAL_RX_CTRL_EMPTY); j++) {
+		if (j == NUM_RX_DESC)
+			return 0;
+		i = (i + 1) % NUM_RX_DESC;
+	}
+
+	/* put back the ring buffers of any earlier arming */
+	for (j = dest ? n : 0; j < NUM_RX_DESC; j++) {
+		k = (i + j) % NUM_RX_DESC;
+		if (!(hw_p->rx[k].ctrl & MAL_RX_CTRL_EMPTY))
+			break;
+		hw_p->rx[k].data_ptr = ENET_RX_BUF(k);
+	}
+
+	if (dest == NULL || n < 2)
+		return 0;
+
+	i = (i + n) % NUM_RX_DESC;
+	dest += len;
+	for (armed = 1; armed < count && (armed + 1) * n <= NUM_RX_DESC; armed++) {
+		if (dest + n * MAL_BUF_SIZE - hdrlen > end)
+			break;
+		for (j = 0; j < n; j++)
+			if (!(hw_p->rx[(i + j) % NUM_RX_DESC].ctrl & MAL_RX_CTRL_EMPTY))
+				goto out;
+		for (j = 1; j < n; j++)
+			hw_p->rx[(i + j) % NUM_RX_DESC].data_ptr = (char *)dest +
+				j * MAL_BUF_SIZE - hdrlen;
+		i = (i + n) % NUM_RX_DESC;
+		dest += len;
+	}
+out:
+	sync();
+	return armed - 1;
+}
+#endif
+
+/*
+ * Hand the n buffers of the frame at the head of the receive ready
+ * queue back to the ring and dequeue it.
+ */
+static void enet_rx_release (EMAC_4XX_HW_PST hw_p, int first, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		int k = (first + i) % NUM_RX_DESC;
+
+		hw_p->rx[k].data_ptr = ENET_RX_BUF(k);
+		hw_p->rx[k].ctrl |= MAL_RX_CTRL_EMPTY;
+	}
+	hw_p->rx_ready[hw_p->rx_u_index] = -1;
+	hw_p->rx_u_index++;
+	if (NUM_RX_DESC == hw_p->rx_u_index)
+		hw_p->rx_u_index = 0;
+}
+
 static int ppc_4xx_eth_rx (struct eth_device *dev)
 {
 	int length;
 	int user_index;
+	int n;
+	uchar *pkt;
 	unsigned long msr;
 	EMAC_4XX_HW_PST hw_p = dev->priv;
 
@@ -1883,22 +2085,38 @@ static int ppc_4xx_eth_rx (struct eth_device *dev)
 		msr = mfmsr ();
 		mtmsr (msr & ~(MSR_EE));
 
-		length = hw_p->rx[user_index].data_len & 0x0fff;
+		length = hw_p->rx_ready_len[hw_p->rx_u_index];
+		n = (length + MAL_BUF_SIZE - 1) / MAL_BUF_SIZE;
+		pkt = (uchar *)hw_p->rx[user_index].data_ptr;
 
 		/* Pass the packet up to the protocol layers. */
 		/*	 NetReceive(NetRxPackets[rxIdx], length - 4); */
 		/*	 NetReceive(NetRxPackets[i], length); */
-		invalidate_dcache_range((u32)hw_p->rx[user_index].data_ptr,
-					(u32)hw_p->rx[user_index].data_ptr +
-					length - 4);
-		NetReceive (NetRxPackets[user_index], length - 4);
-		/* Free Recv Buffer */
-		hw_p->rx[user_index].ctrl |= MAL_RX_CTRL_EMPTY;
-		/* Free rx buffer descriptor queue */
-		hw_p->rx_ready[hw_p->rx_u_index] = -1;
-		hw_p->rx_u_index++;
-		if (NUM_RX_BUFF == hw_p->rx_u_index)
-			hw_p->rx_u_index = 0;
+		switch (enet_rx_layout(hw_p, user_index, n)) {
+		case 0:
+			invalidate_dcache_range((u32)pkt, (u32)pkt + length);
+			NetReceive (pkt, length - ENET_RX_FCS);
+			break;
+#ifdef CONFIG_NET_RX_PLACE
+		case 1: {
+			uchar *tail = (uchar *)hw_p->rx[user_index + 1].data_ptr;
+
+			invalidate_dcache_range((u32)pkt, (u32)pkt + MAL_BUF_SIZE);
+			invalidate_dcache_range((u32)tail,
+						(u32)tail + length - MAL_BUF_SIZE);
+			NetReceivePlaced(pkt, length - ENET_RX_FCS, MAL_BUF_SIZE,
+					 tail);
+			break;
+		}
+#endif
+#if MAL_BUF_PER_PKT > 1
+		default:
+			pkt = enet_rx_gather(hw_p, user_index, length);
+			NetReceive (pkt, length - ENET_RX_FCS);
+			break;
+#endif
+		}
+		enet_rx_release(hw_p, user_index, n);
 
 #ifdef INFO_4XX_ENET
 		hw_p->stats.pkts_handled++;
@@ -1912,6 +2130,99 @@ static int ppc_4xx_eth_rx (struct eth_device *dev)
 	return length;
 }
 
+#ifdef CONFIG_NET_KEEP_LINK
+/*
+ * Drop the frames waiting in the receive ready queue. Called with
+ * interrupts off.
+ */
+static void enet_rx_flush (struct eth_device *dev)
+{
+	EMAC_4XX_HW_PST hw_p = dev->priv;
+	int user_index;
+	int length;
+
+	while ((user_index = hw_p->rx_ready[hw_p->rx_u_index]) != -1) {
+		length = hw_p->rx_ready_len[hw_p->rx_u_index];
+		enet_rx_release(hw_p, user_index,
+				(length + MAL_BUF_SIZE - 1) / MAL_BUF_SIZE);
+	}
+}
+
+/*-----------------------------------------------------------------------------+
+| ppc_4xx_eth_park
+| Disable the EMAC receiver only; MAL channels, rings and PHY link are
+| kept for the next eth_init()
++-----------------------------------------------------------------------------*/
+static void ppc_4xx_eth_park (struct eth_device *dev)
+{
+	EMAC_4XX_HW_PST hw_p = dev->priv;
+	unsigned long msr;
+	u32 failsafe = 10000;
+	u32 mode_reg;
+
+	msr = mfmsr ();
+	mtmsr (msr & ~(MSR_EE));
+
+	mode_reg = in_be32((void *)EMAC0_MR0 + hw_p->hw_addr);
+	out_be32((void *)EMAC0_MR0 + hw_p->hw_addr, mode_reg & ~EMAC_MR0_RXE);
+
+	/* let a frame on the wire finish */
+	while (!(in_be32((void *)EMAC0_MR0 + hw_p->hw_addr) & EMAC_MR0_RXI) &&
+	       failsafe--)
+		udelay (1);
+
+	enet_rx_flush(dev);
+#ifdef CONFIG_NET_RX_PLACE
+	ppc_4xx_eth_rx_place(dev, NULL, 0, 0, 0, NULL);
+#endif
+	hw_p->parked = 1;
+
+	mtmsr (msr);
+}
+
+/*
+ * Restart a parked EMAC if the PHY still has the link it was set up
+ * for. Returns -1 if a full init is needed.
+ */
+static int ppc_4xx_eth_resume (struct eth_device *dev)
+{
+	EMAC_4XX_HW_PST hw_p = dev->priv;
+	int phy = hw_p->bis->bi_phynum[hw_p->devnum];
+	unsigned short reg_short;
+	unsigned long msr;
+	u32 mode_reg;
+
+	if (phy != CONFIG_FIXED_PHY) {
+		/* the link status bit latches low, read it twice */
+		miiphy_read (dev->name, phy, MII_BMSR, &reg_short);
+		if (miiphy_read (dev->name, phy, MII_BMSR, &reg_short) ||
+		    !(reg_short & BMSR_LSTATUS))
+			return -1;
+		if (miiphy_speed(dev->name, phy) != hw_p->link_speed ||
+		    miiphy_duplex(dev->name, phy) != hw_p->link_duplex)
+			return -1;
+	}
+
+	msr = mfmsr ();
+	mtmsr (msr & ~(MSR_EE));
+
+	/* ethaddr may have changed since */
+	out_be32((void *)EMAC0_IAH + hw_p->hw_addr,
+		 (dev->enetaddr[0] << 8) | dev->enetaddr[1]);
+	out_be32((void *)EMAC0_IAL + hw_p->hw_addr,
+		 (dev->enetaddr[2] << 24) | (dev->enetaddr[3] << 16) |
+		 (dev->enetaddr[4] << 8) | dev->enetaddr[5]);
+
+	enet_rx_flush(dev);
+	mode_reg = in_be32((void *)EMAC0_MR0 + hw_p->hw_addr);
+	out_be32((void *)EMAC0_MR0 + hw_p->hw_addr, mode_reg | EMAC_MR0_RXE);
+	hw_p->parked = 0;
+
+	mtmsr (msr);
+	return 0;
+}
+#endif
+
 int ppc_4xx_eth_initialize (bd_t * bis)
 {
 	static int virgin = 0;
@@ -2034,6 +2345,12 @@ int ppc_4xx_eth_initialize (bd_t * bis)
 		dev->halt = ppc_4xx_eth_halt;
 		dev->send = ppc_4xx_eth_send;
 		dev->recv = ppc_4xx_eth_rx;
+#ifdef CONFIG_NET_RX_PLACE
+		dev->rx_place = ppc_4xx_eth_rx_place;
+#endif
+#ifdef CONFIG_NET_KEEP_LINK
+		dev->park = ppc_4xx_eth_park;
+#endif
 
 		if (0 == virgin) {
 			/* set the MAL IER ??? names may change with new spec ??? */
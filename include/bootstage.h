@@ -0,0 +1,34 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA
+ */
+
+#ifndef _BOOTSTAGE_H_
+#define _BOOTSTAGE_H_
+
+/*
+ * Boot stage recorder: bootstage_mark() stores a timebase stamp in the
+ * global data, usable from the first init_sequence[] step on. Steps
+ * without a name are identified by their function address.
+ */
+#ifdef CONFIG_BOOTSTAGE
+void bootstage_mark(const char *name, ulong id);
+int bootstage_fdt(void *blob);
+#else
+static inline void bootstage_mark(const char *name, ulong id) {}
+static inline int bootstage_fdt(void *blob) { return 0; }
+#endif
+
+#endif /* _BOOTSTAGE_H_ */
@@ -86,7 +86,7 @@
 
 /* 440EPx/440GRx have 16KB of internal SRAM, so no need for D-Cache  */
 #define CONFIG_SYS_INIT_RAM_ADDR   CONFIG_SYS_OCM_BASE  /* OCM      */
-#define CONFIG_SYS_INIT_RAM_SIZE   (4 << 10)
+#define CONFIG_SYS_INIT_RAM_SIZE   (8 << 10)  /* room for the bootstage table */
 #define CONFIG_SYS_GBL_DATA_OFFSET (CONFIG_SYS_INIT_RAM_SIZE - GENERATED_GBL_DATA_SIZE)
 #define CONFIG_SYS_INIT_SP_OFFSET  (CONFIG_SYS_GBL_DATA_OFFSET - 0x4)
 
@@ -131,6 +131,10 @@
 #define CONFIG_SYS_I2C_DTT_ADDR    0x4c /* Air outlet temperature */
 #define CONFIG_DTT_SENSORS         {0x0, 0x2}  /* Sensor address offsets for dtt command*/
 
+/* fpga fan follows the max1805 remote temperatures while idle or busy */
+#define CONFIG_ROACH2_THERMAL
+#define CONFIG_SHOW_ACTIVITY      /* console and net loop poll hook */
+
 /*-----------------------------------------------------------------------
  * DDR2 SDRAM
  *----------------------------------------------------------------------*/
@@ -164,6 +168,16 @@
    but for some reason that breaks the compile.  */
 
 #define CONFIG_SYS_RX_ETH_BUFFER  32  /* number of eth rx buffers  */
+#define CONFIG_NET_MTU            9000 /* jumbo frames, tftpblocksize up to 8968 */
+#define CONFIG_NET_RX_PLACE       /* tftp payload dma'd straight to load_addr */
+#define CONFIG_NET_KEEP_LINK      /* no renegotiation between net commands */
+
+#define CONFIG_ROACH2_V6GBE       /* fpga 1GbE core as second eth device */
+
+#define CONFIG_TFTP_STORE_HOOK    /* lets r2smap stream bitstreams from tftp */
+#define CONFIG_TFTP_WINDOWSIZE 16 /* rfc 7440 blocks per ack, fits the rx ring */
+#define CONFIG_NFS_READ_SIZE   8192 /* largest nfsreadsize: nfsv2 maximum, one jumbo frame */
+#define CONFIG_NFS_READ_WINDOW 8
 
 /*-----------------------------------------------------------------------
  * USB
@@ -273,6 +287,7 @@
 #define CONFIG_CMD_R2SENSORS
 #define CONFIG_CMD_R2RTC
 #define CONFIG_CMD_R2BIT
+#define CONFIG_CMD_R2EBC /* needs CONFIG_CMD_R2SMAP and CONFIG_CMD_R2BIT */
 
 /*-----------------------------------------------------------------------
  * Miscellaneous configurable options
@@ -325,6 +340,8 @@
  */
 #define CONFIG_SYS_BOOTMAPSZ    (16 << 20) /* Initial Memory map for Linux */
 #define CONFIG_SYS_BOOTM_LEN    (16 << 20) /* Increase max gunzip size */
+#define CONFIG_LZMA                        /* lzma images for bootm and r2smap */
+#define CONFIG_LZO                         /* lzop images for bootm and r2smap */
 
 /*
  * Pass open firmware flat tree
@@ -339,6 +356,10 @@
 /* Update size in "reg" property of NOR FLASH device tree nodes */
 #define CONFIG_FDT_FIXUP_NOR_FLASH_SIZE
 
+/* boot stage timestamps: 'bootstage' command and /bootstage in the tree */
+#define CONFIG_BOOTSTAGE
+#define CONFIG_BOOTSTAGE_MAX      64 /* init_sequence[] alone takes ~20 */
+
 /*-----------------------------------------------------------------------
  * Booting and default environment
  *----------------------------------------------------------------------*/
@@ -94,7 +94,8 @@ typedef void	thand_f(void);
 enum eth_state_t {
 	ETH_STATE_INIT,
 	ETH_STATE_PASSIVE,
-	ETH_STATE_ACTIVE
+	ETH_STATE_ACTIVE,
+	ETH_STATE_PARKED
 };
 
 struct eth_device {
@@ -109,6 +110,16 @@ struct eth_device {
 	void (*halt) (struct eth_device*);
 #ifdef CONFIG_MCAST_TFTP
 	int (*mcast) (struct eth_device*, u32 ip, u8 set);
+#endif
+#ifdef CONFIG_NET_RX_PLACE
+	int (*rx_place) (struct eth_device*, uchar *dest, int hdrlen,
+			 int len, int count, uchar *end);
+#endif
+#ifdef CONFIG_NET_KEEP_LINK
+	void (*park) (struct eth_device*);
+#endif
+#ifdef CONFIG_NET_MTU
+	int mtu;	/* largest IP packet when below CONFIG_NET_MTU, else 0 */
 #endif
 	int  (*write_hwaddr) (struct eth_device*);
 	struct eth_device *next;
@@ -141,11 +152,49 @@ extern int eth_rx(void);			/* Check for received packets */
 extern void eth_halt(void);			/* stop SCC */
 extern char *eth_get_name(void);		/* get name of current device */
 
+/*
+ * Persistent link. At the end of a network command the device is only
+ * parked: it stops receiving but keeps its rings and PHY link, so the
+ * next eth_init() resumes it without renegotiating. eth_halt() leaves
+ * a parked device alone; eth_halt_all() really stops every device and
+ * has to be called before handing the machine to an OS.
+ */
+#ifdef CONFIG_NET_KEEP_LINK
+extern void eth_park(void);
+extern void eth_halt_all(void);
+#else
+#define eth_park()	eth_halt()
+#endif
+
 #ifdef CONFIG_MCAST_TFTP
 int eth_mcast_join( IPaddr_t mcast_addr, u8 join);
 u32 ether_crc (size_t len, unsigned char const *p);
 #endif
 
+/*
+ * Receive placement. A bulk transfer that knows where the payload of
+ * its next frames belongs asks the driver to DMA everything past the
+ * first receive buffer of each frame straight there: count frames of
+ * hdrlen header and len payload bytes, for payload at dest, dest + len,
+ * and so on. Receive buffers span more than len, so the driver only
+ * arms a frame whose buffers all end at or below end. Such frames reach the net core via NetReceivePlaced(), and
+ * protocols move payload with NetCopyPayload(), which skips whatever
+ * is already in place. A NULL dest drops any arming left over.
+ */
+#ifdef CONFIG_NET_RX_PLACE
+extern int eth_rx_place(ushort port, uchar *dest, int hdrlen, int len,
+			int count, uchar *end);
+extern void NetReceivePlaced(uchar *pkt, int len, int head, uchar *tail);
+extern void NetCopyPayload(void *dest, uchar *src, int len);
+#else
+static inline int eth_rx_place(ushort port, uchar *dest, int hdrlen,
+			       int len, int count, uchar *end)
+{
+	return 0;
+}
+#define NetCopyPayload(dest, src, len)	memcpy(dest, src, len)
+#endif
+
 
 /**********************************************************************/
 /*
@@ -296,8 +345,18 @@ typedef struct icmphdr {
  * maximum packet size =  1518
  * maximum packet size and multiple of 32 bytes =  1536
  */
+#ifdef CONFIG_NET_MTU
+/*
+ * Jumbo frames: room for the ethernet header and fcs around the IP MTU.
+ * Slots are a multiple of 2K so drivers whose DMA buffers are limited in
+ * size can split a slot evenly between several descriptors.
+ */
+#define PKTSIZE			(CONFIG_NET_MTU + 18)
+#define PKTSIZE_ALIGN		((PKTSIZE + 2047) & ~2047)
+#else
 #define PKTSIZE			1518
 #define PKTSIZE_ALIGN		1536
+#endif
 /*#define PKTSIZE		608*/
 
 /*
@@ -370,6 +429,16 @@ typedef enum { BOOTP, RARP, ARP, TFTP, DHCP, PING, DNS, NFS, CDP, NETCONS, SNTP,
 /* from net/net.c */
 extern char	BootFile[128];			/* Boot File name		*/
 
+#if defined(CONFIG_TFTP_STORE_HOOK)
+/*
+ * When set, TFTP passes every received data block to this hook instead
+ * of copying it to load_addr. The offset is relative to the start of the
+ * file; a transfer restart begins again at offset 0. A non-zero return
+ * value aborts the transfer.
+ */
+extern int (*TftpStoreHook)(ulong offset, uchar *src, unsigned len);
+#endif
+
 #if defined(CONFIG_CMD_DNS)
 extern char *NetDNSResolve;		/* The host to resolve  */
 extern char *NetDNSenvvar;		/* the env var to put the ip into */
@@ -342,6 +342,20 @@ u32 ether_crc (size_t len, unsigned char const *p)
 
 #endif
 
+#ifdef CONFIG_NET_RX_PLACE
+extern ushort NetRxPlacePort;
+
+int eth_rx_place(ushort port, uchar *dest, int hdrlen, int len, int count,
+		 uchar *end)
+{
+	if (!eth_current || !eth_current->rx_place)
+		return 0;
+	NetRxPlacePort = dest ? port : 0;
+	return eth_current->rx_place(eth_current, dest, hdrlen, len, count,
+				     end);
+}
+#endif
+
 
 int eth_init(bd_t *bis)
 {
@@ -366,6 +380,18 @@ int eth_init(bd_t *bis)
 		dev = dev->next;
 	} while (dev != eth_devices);
 
+#ifdef CONFIG_NET_KEEP_LINK
+	/* only one device stays parked, the one about to be used */
+	dev = eth_devices;
+	do {
+		if (dev != eth_current && dev->state == ETH_STATE_PARKED) {
+			dev->halt(dev);
+			dev->state = ETH_STATE_PASSIVE;
+		}
+		dev = dev->next;
+	} while (dev != eth_devices);
+#endif
+
 	old_current = eth_current;
 	do {
 		debug("Trying %s\n", eth_current->name);
@@ -388,11 +414,48 @@ void eth_halt(void)
 	if (!eth_current)
 		return;
 
+#ifdef CONFIG_NET_KEEP_LINK
+	if (eth_current->state == ETH_STATE_PARKED)
+		return;
+#endif
 	eth_current->halt(eth_current);
 
 	eth_current->state = ETH_STATE_PASSIVE;
 }
 
+#ifdef CONFIG_NET_KEEP_LINK
+void eth_park(void)
+{
+	if (!eth_current)
+		return;
+
+	if (eth_current->state != ETH_STATE_ACTIVE || !eth_current->park) {
+		eth_halt();
+		return;
+	}
+	eth_current->park(eth_current);
+
+	eth_current->state = ETH_STATE_PARKED;
+}
+
+void eth_halt_all(void)
+{
+	struct eth_device *dev = eth_devices;
+
+	if (!dev)
+		return;
+
+	do {
+		if (dev->state == ETH_STATE_ACTIVE ||
+		    dev->state == ETH_STATE_PARKED) {
+			dev->halt(dev);
+			dev->state = ETH_STATE_PASSIVE;
+		}
+		dev = dev->next;
+	} while (dev != eth_devices);
+}
+#endif
+
 int eth_send(volatile void *packet, int length)
 {
 	if (!eth_current)
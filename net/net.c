@@ -524,6 +524,7 @@ restart:
 		 *	Abort if ctrl-c was pressed.
 		 */
 		if (ctrlc()) {
+			eth_rx_place(0, NULL, 0, 0, 0, NULL);
 			eth_halt();
 			puts("\nAbort\n");
 			return -1;
@@ -579,7 +580,7 @@ restart:
 				sprintf(buf, "%lX", (unsigned long)load_addr);
 				setenv("fileaddr", buf);
 			}
-			eth_halt();
+			eth_park();
 			return NetBootFileXferSize;
 
 		case NETLOOP_FAIL:
@@ -1356,6 +1357,67 @@ static inline IP_t *NetDefragment(IP_t *ip, int *lenp)
 }
 #endif
 
+#ifdef CONFIG_NET_RX_PLACE
+/* UDP port of the transfer frames are being placed for, 0 for none */
+ushort		NetRxPlacePort;
+/* receive buffer part and placed part of the frame being handled */
+static uchar	*NetRxPlaceHead;
+static int	NetRxPlaceHeadLen;
+static uchar	*NetRxPlaceTail;
+
+/*
+ * Hand up a frame whose first head bytes are at pkt and the rest at
+ * tail, see eth_rx_place(). pkt must have room for the whole frame:
+ * anything but an unfragmented UDP datagram to the placing transfer is
+ * made contiguous first, so other protocols never see a split frame.
+ */
+void NetReceivePlaced(uchar *pkt, int len, int head, uchar *tail)
+{
+	IP_t *ip = (IP_t *)(pkt + ETHER_HDR_SIZE);
+
+	if (NetRxPlacePort == 0 || head < ETHER_HDR_SIZE + IP_HDR_SIZE ||
+	    ntohs(((Ethernet_t *)pkt)->et_protlen) != PROT_IP ||
+	    ip->ip_hl_v != 0x45 || ip->ip_p != IPPROTO_UDP ||
+	    (ntohs(ip->ip_off) & (IP_OFFS | IP_FLAGS_MFRAG)) ||
+	    ntohs(ip->udp_dst) != NetRxPlacePort) {
+		memcpy(pkt + head, tail, len - head);
+		NetReceive(pkt, len);
+		return;
+	}
+
+	NetRxPlaceHead = pkt;
+	NetRxPlaceHeadLen = head;
+	NetRxPlaceTail = tail;
+	NetReceive(pkt, len);
+	NetRxPlaceHead = NULL;
+}
+
+/*
+ * Copy received payload to dest. For a placed frame only the part
+ * still in the receive buffer is copied; the rest normally already
+ * sits right behind it and is moved only if it landed elsewhere.
+ */
+void NetCopyPayload(void *dest, uchar *src, int len)
+{
+	int head;
+
+	if (NetRxPlaceHead == NULL || src < NetRxPlaceHead ||
+	    src >= NetRxPlaceHead + NetRxPlaceHeadLen) {
+		memcpy(dest, src, len);
+		return;
+	}
+
+	head = NetRxPlaceHead + NetRxPlaceHeadLen - src;
+	if (head >= len) {
+		memcpy(dest, src, len);
+		return;
+	}
+	memcpy(dest, src, head);
+	if ((uchar *)dest + head != NetRxPlaceTail)
+		memmove((uchar *)dest + head, NetRxPlaceTail, len - head);
+}
+#endif
+
 void
 NetReceive(volatile uchar *inpkt, int len)
 {
@@ -35,8 +35,17 @@
 
 static int fs_mounted = 0;
 static unsigned long rpc_id = 0;
-static int nfs_offset = -1;
+static int nfs_offset = -1;	/* offset of the next READ to issue */
 static int nfs_len;
+static int nfs_filesize;	/* from the first READ reply, -1 before */
+
+/* READs in flight, matched to their replies by xid */
+static struct {
+	unsigned long id;	/* 0 if the slot is free */
+	int offset;
+	ulong time;		/* get_timer() when last sent */
+} nfs_reads[NFS_READ_WINDOW];
+static int nfs_reads_out;
 
 static char dirfh[NFS_FHSIZE];	/* file handle of directory */
 static char filefh[NFS_FHSIZE]; /* file handle of kernel image */
@@ -346,6 +355,57 @@ nfs_read_req (int offset, int readlen)
 	rpc_req (PROG_NFS, NFS_READ, data, len);
 }
 
+static void
+nfs_read_slot_send (int i)
+{
+	nfs_read_req (nfs_reads[i].offset, nfs_len);
+	nfs_reads[i].id = rpc_id;
+	nfs_reads[i].time = get_timer(0);
+}
+
+/* Issue READs for the rest of the file while there is room */
+static void
+nfs_read_fill (void)
+{
+	int i;
+
+	for (i = 0; i < NFS_READ_WINDOW; i++) {
+		if (nfs_reads[i].id)
+			continue;
+		/* until the first reply gives the file size, one at a time */
+		if (nfs_filesize < 0 ? nfs_reads_out : nfs_offset >= nfs_filesize)
+			break;
+		nfs_reads[i].offset = nfs_offset;
+		nfs_offset += nfs_len;
+		nfs_reads_out++;
+		nfs_read_slot_send (i);
+	}
+}
+
+/* Send again the READs without reply for timeout ms, with a new xid */
+static void
+nfs_read_resend (ulong timeout)
+{
+	int i;
+
+	for (i = 0; i < NFS_READ_WINDOW; i++) {
+		if (nfs_reads[i].id && get_timer(nfs_reads[i].time) >= timeout)
+			nfs_read_slot_send (i);
+	}
+}
+
+static int
+nfs_read_slot (unsigned long id)
+{
+	int i;
+
+	for (i = 0; i < NFS_READ_WINDOW; i++) {
+		if (nfs_reads[i].id == id)
+			return i;
+	}
+	return -1;
+}
+
 /**************************************************************************
 RPC request dispatcher
 **************************************************************************/
@@ -372,7 +432,8 @@ NfsSend (void)
 		nfs_lookup_req (nfs_filename);
 		break;
 	case STATE_READ_REQ:
-		nfs_read_req (nfs_offset, nfs_len);
+		nfs_read_resend (0);
+		nfs_read_fill ();
 		break;
 	case STATE_READLINK_REQ:
 		nfs_readlink_req ();
@@ -384,6 +445,15 @@ NfsSend (void)
 Handlers for the reply from server
 **************************************************************************/
 
+static unsigned long
+rpc_reply_id (uchar *pkt)
+{
+	uint32_t id;
+
+	memcpy (&id, pkt, sizeof(id));
+	return ntohl(id);
+}
+
 static int
 rpc_lookup_reply (int prog, uchar *pkt, unsigned len)
 {
@@ -523,18 +593,16 @@ nfs_readlink_reply (uchar *pkt, unsigned len)
 }
 
 static int
-nfs_read_reply (uchar *pkt, unsigned len)
+nfs_read_reply (int slot, uchar *pkt, unsigned len)
 {
 	struct rpc_t rpc_pkt;
+	int offset = nfs_reads[slot].offset;
 	int rlen;
 
 	debug("%s\n", __func__);
 
 	memcpy ((uchar *)&rpc_pkt, pkt, sizeof(rpc_pkt.u.reply));
 
-	if (ntohl(rpc_pkt.u.reply.id) != rpc_id)
-		return -1;
-
 	if (rpc_pkt.u.reply.rstatus  ||
 	    rpc_pkt.u.reply.verifier ||
 	    rpc_pkt.u.reply.astatus  ||
@@ -548,15 +616,20 @@ nfs_read_reply (uchar *pkt, unsigned len)
 		return -ntohl(rpc_pkt.u.reply.data[0]);;
 	}
 
-	if ((nfs_offset!=0) && !((nfs_offset) % (NFS_READ_SIZE/2*10*HASHES_PER_LINE))) {
+	if ((offset!=0) && !((offset) % (nfs_len*5*HASHES_PER_LINE))) {
 		puts ("\n\t ");
 	}
-	if (!(nfs_offset % ((NFS_READ_SIZE/2)*10))) {
+	if (!(offset % (nfs_len*5))) {
 		putc ('#');
 	}
 
+	if (nfs_filesize < 0)
+		nfs_filesize = ntohl(rpc_pkt.u.reply.data[6]);	/* fattr size */
+
 	rlen = ntohl(rpc_pkt.u.reply.data[18]);
-	if ( store_block ((uchar *)pkt+sizeof(rpc_pkt.u.reply), nfs_offset, rlen) )
+	if (rlen > nfs_len || sizeof(rpc_pkt.u.reply) + rlen > len)
+		return -9999;
+	if ( store_block ((uchar *)pkt+sizeof(rpc_pkt.u.reply), offset, rlen) )
 		return -9999;
 
 	return rlen;
@@ -583,6 +656,8 @@ static void
 NfsHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src, unsigned len)
 {
 	int rlen;
+	int slot;
+	int offset;
 
 	debug("%s\n", __func__);
 
@@ -614,6 +689,9 @@ NfsHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src, unsigned len)
 		break;
 
 	case STATE_UMOUNT_REQ:
+		/* late replies to READs sent twice may still come in */
+		if (rpc_reply_id(pkt) != rpc_id)
+			break;
 		if (nfs_umountall_reply(pkt, len)) {
 			puts ("*** ERROR: Cannot umount\n");
 			NetState = NETLOOP_FAIL;
@@ -631,7 +709,9 @@ NfsHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src, unsigned len)
 		} else {
 			NfsState = STATE_READ_REQ;
 			nfs_offset = 0;
-			nfs_len = NFS_READ_SIZE;
+			nfs_filesize = -1;
+			memset (nfs_reads, 0, sizeof(nfs_reads));
+			nfs_reads_out = 0;
 			NfsSend ();
 		}
 		break;
@@ -652,18 +732,41 @@ NfsHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src, unsigned len)
 		break;
 
 	case STATE_READ_REQ:
-		rlen = nfs_read_reply (pkt, len);
+		slot = nfs_read_slot (rpc_reply_id(pkt));
+		if (slot < 0)
+			break;	/* answer to a READ sent again since */
+		rlen = nfs_read_reply (slot, pkt, len);
 		NetSetTimeout (NFS_TIMEOUT, NfsTimeout);
-		if (rlen > 0) {
-			nfs_offset += rlen;
-			NfsSend ();
+		if (rlen >= 0) {
+			offset = nfs_reads[slot].offset;
+			if (rlen > 0 && rlen < nfs_len &&
+			    offset + rlen < nfs_filesize) {
+				/* short read, ask for the rest */
+				nfs_reads[slot].offset += rlen;
+				nfs_read_slot_send (slot);
+			} else {
+				nfs_reads[slot].id = 0;
+				nfs_reads_out--;
+				/* the file shrank since the first reply */
+				if (rlen == 0 && offset < nfs_filesize)
+					nfs_filesize = offset;
+			}
+
+			if (nfs_reads_out == 0 && nfs_offset >= nfs_filesize) {
+				NfsDownloadState = NETLOOP_SUCCESS;
+				NfsState = STATE_UMOUNT_REQ;
+				NfsSend ();
+			} else {
+				/* a lost request need not wait for the window */
+				nfs_read_resend (NFS_TIMEOUT);
+				nfs_read_fill ();
+			}
 		}
 		else if ((rlen == -NFSERR_ISDIR)||(rlen == -NFSERR_INVAL)) {
 			/* symbolic link */
 			NfsState = STATE_READLINK_REQ;
 			NfsSend ();
 		} else {
-			if ( ! rlen ) NfsDownloadState = NETLOOP_SUCCESS;
 			NfsState = STATE_UMOUNT_REQ;
 			NfsSend ();
 		}
@@ -675,9 +778,18 @@ NfsHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src, unsigned len)
 void
 NfsStart (void)
 {
+	char *s;
+
 	debug("%s\n", __func__);
 	NfsDownloadState = NETLOOP_FAIL;
 
+	s = getenv("nfsreadsize");
+	nfs_len = s ? simple_strtoul(s, NULL, 10) : 0;
+	if (nfs_len <= 0)
+		nfs_len = NFS_READ_DEFAULT;
+	if (nfs_len > NFS_READ_SIZE)
+		nfs_len = NFS_READ_SIZE;
+
 	NfsServerIP = NetServerIP;
 	nfs_path = (char *)nfs_path_buff;
 
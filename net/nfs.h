@@ -47,6 +47,24 @@
 #define NFS_READ_SIZE 1024 /* biggest power of two that fits Ether frame */
 #endif
 
+/*
+ * Block size used unless the "nfsreadsize" variable asks for another,
+ * up to NFS_READ_SIZE. Jumbo frames need every hop to the server to
+ * carry them, so the default stays within a standard frame.
+ */
+#if NFS_READ_SIZE > 1024
+#define NFS_READ_DEFAULT 1024
+#else
+#define NFS_READ_DEFAULT NFS_READ_SIZE
+#endif
+
+/* Number of READ requests kept in flight during a download. */
+#ifdef CONFIG_NFS_READ_WINDOW
+#define NFS_READ_WINDOW CONFIG_NFS_READ_WINDOW
+#else
+#define NFS_READ_WINDOW 1
+#endif
+
 #define NFS_MAXLINKDEPTH 16
 
 struct rpc_t {
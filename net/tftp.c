@@ -12,6 +12,8 @@
 #include "tftp.h"
 #include "bootp.h"
 
+DECLARE_GLOBAL_DATA_PTR;
+
 /* Well known TFTP port # */
 #define WELL_KNOWN_PORT	69
 /* Millisecs to timeout for lost pkt */
@@ -109,6 +111,10 @@ static char tftp_filename[MAX_LEN];
 extern flash_info_t flash_info[];
 #endif
 
+#ifdef CONFIG_TFTP_STORE_HOOK
+int (*TftpStoreHook)(ulong offset, uchar *src, unsigned len);
+#endif
+
 /* 512 is poor choice for ethernet, MTU is typically 1500.
  * Minus eth.hdrs thats 1468.  Can get 2x better throughput with
  * almost-MTU block sizes.  At least try... fall back to 512 if need be.
@@ -120,9 +126,32 @@ extern flash_info_t flash_info[];
 #define TFTP_MTU_BLOCKSIZE 1468
 #endif
 
+/* largest block that fits in a single ethernet frame */
+#define TFTP_MAX_BLOCKSIZE \
+	(PKTSIZE - ETHER_HDR_SIZE - 4 - IP_HDR_SIZE - 4)
+
 static unsigned short TftpBlkSize = TFTP_BLOCK_SIZE;
 static unsigned short TftpBlkSizeOption = TFTP_MTU_BLOCKSIZE;
 
+/*
+ * RFC 7440 windowsize: the server sends this many blocks before waiting
+ * for an ACK. Only blocks received in order are stored; a gap is
+ * answered with an ACK of the last block in order, which restarts the
+ * window from there. 1 is plain lock-step RFC 1350 TFTP.
+ */
+#ifdef CONFIG_TFTP_WINDOWSIZE
+#define TFTP_WINDOWSIZE CONFIG_TFTP_WINDOWSIZE
+#else
+#define TFTP_WINDOWSIZE 1
+#endif
+
+static unsigned short TftpWindowSize = 1;
+static unsigned short TftpWindowSizeOption = TFTP_WINDOWSIZE;
+/* blocks received since the last ACK */
+static unsigned short TftpWindowCount;
+/* last block in order when a gap was last answered, -1 if none since */
+static ulong TftpGapBlock;
+
 #ifdef CONFIG_MCAST_TFTP
 #include <malloc.h>
 #define MTFTP_BITMAPSIZE	0x1000
@@ -157,7 +186,20 @@ store_block(unsigned block, uchar *src, unsigned len)
 	ulong newsize = offset + len;
 #ifdef CONFIG_SYS_DIRECT_FLASH_TFTP
 	int i, rc = 0;
+#endif
+
+#ifdef CONFIG_TFTP_STORE_HOOK
+	if (TftpStoreHook) {
+		/* data is consumed as it arrives, nothing lands at load_addr */
+		if ((*TftpStoreHook)(offset, src, len))
+			NetState = NETLOOP_FAIL;
+		if (NetBootFileXferSize < newsize)
+			NetBootFileXferSize = newsize;
+		return;
+	}
+#endif
 
+#ifdef CONFIG_SYS_DIRECT_FLASH_TFTP
 	for (i = 0; i < CONFIG_SYS_MAX_FLASH_BANKS; i++) {
 		/* start address in flash? */
 		if (flash_info[i].flash_id == FLASH_UNKNOWN)
@@ -179,7 +221,7 @@ store_block(unsigned block, uchar *src, unsigned len)
 	else
 #endif /* CONFIG_SYS_DIRECT_FLASH_TFTP */
 	{
-		(void)memcpy((void *)(load_addr + offset), src, len);
+		NetCopyPayload((void *)(load_addr + offset), src, len);
 	}
 #ifdef CONFIG_MCAST_TFTP
 	if (Multicast)
@@ -193,6 +235,48 @@ store_block(unsigned block, uchar *src, unsigned len)
 static void TftpSend(void);
 static void TftpTimeout(void);
 
+#ifdef CONFIG_NET_RX_PLACE
+/*
+ * U-Boot's code, malloc area and stack sit at the top of RAM, the stack
+ * lowest; placed payload stays this far below the current stack.
+ */
+#define TFTP_PLACE_STACK_MARGIN	0x10000
+
+/*
+ * Ask the driver to place the payload of the blocks the next ACK asks
+ * for straight at load_addr. Blocks are stored in order, so the next
+ * one always starts at the current transfer size. Only plain downloads
+ * into RAM below U-Boot qualify; the driver keeps what it arms within
+ * that. Called with arm 0 whenever the transfer ends.
+ */
+static void TftpRxPlace(int arm)
+{
+	ulong dest = load_addr + NetBootFileXferSize;
+	ulong top = gd->bd->bi_memstart + gd->bd->bi_memsize;
+	ulong sp = (ulong)&dest - TFTP_PLACE_STACK_MARGIN;
+
+	if (sp < top)
+		top = sp;
+
+	if (arm &&
+#ifdef CONFIG_TFTP_STORE_HOOK
+	    !TftpStoreHook &&
+#endif
+#ifdef CONFIG_MCAST_TFTP
+	    !Multicast &&
+#endif
+	    dest >= gd->bd->bi_memstart && dest < top) {
+		eth_rx_place(TftpOurPort, (uchar *)dest,
+			     ETHER_HDR_SIZE + IP_HDR_SIZE + 4, TftpBlkSize,
+			     TftpWindowSize, (uchar *)top);
+		return;
+	}
+	eth_rx_place(0, NULL, 0, 0, 0, NULL);
+}
+#else
+#define TftpRxPlace(arm)
+#endif
+
 /**********************************************************************/
 
 static void
@@ -239,6 +323,9 @@ TftpSend(void)
 		/* try for more effic. blk size */
 		pkt += sprintf((char *)pkt, "blksize%c%d%c",
 				0, TftpBlkSizeOption, 0);
+		if (TftpWindowSizeOption > 1)
+			pkt += sprintf((char *)pkt, "windowsize%c%d%c",
+					0, TftpWindowSizeOption, 0);
 #ifdef CONFIG_MCAST_TFTP
 		/* Check all preconditions before even trying the option */
 		if (!ProhibitMcast
@@ -269,6 +356,9 @@ TftpSend(void)
 		*s++ = htons(TftpBlock);
 		pkt = (uchar *)s;
 		len = pkt - xp;
+		/* the answer to this ACK may arrive before we are back */
+		if (TftpState != STATE_RECV_WRQ)
+			TftpRxPlace(1);
 		break;
 
 	case STATE_TOO_LARGE:
@@ -365,6 +455,15 @@ TftpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 				debug("Blocksize ack: %s, %d\n",
 					(char *)pkt+i+8, TftpBlkSize);
 			}
+			if (strcmp((char *)pkt+i, "windowsize") == 0) {
+				TftpWindowSize = (unsigned short)
+					simple_strtoul((char *)pkt+i+11, NULL,
+						       10);
+				if (TftpWindowSize == 0)
+					TftpWindowSize = 1;
+				debug("Windowsize ack: %s, %d\n",
+					(char *)pkt+i+11, TftpWindowSize);
+			}
 #ifdef CONFIG_TFTP_TSIZE
 			if (strcmp((char *)pkt+i, "tsize") == 0) {
 				TftpTsize = simple_strtoul((char *)pkt+i+6,
@@ -376,6 +475,9 @@ TftpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 		}
 #ifdef CONFIG_MCAST_TFTP
 		parse_multicast_oack((char *)pkt, len-1);
+		/* multicast clients keep their own bitmap of missing blocks */
+		if (Multicast)
+			TftpWindowSize = 1;
 		if ((Multicast) && (!MasterClient))
 			TftpState = STATE_DATA;	/* passive.. */
 		else
@@ -388,35 +490,6 @@ TftpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 		len -= 2;
 		TftpBlock = ntohs(*(ushort *)pkt);
 
-		/*
-		 * RFC1350 specifies that the first data packet will
-		 * have sequence number 1. If we receive a sequence
-		 * number of 0 this means that there was a wrap
-		 * around of the (16 bit) counter.
-		 */
-		if (TftpBlock == 0) {
-			TftpBlockWrap++;
-			TftpBlockWrapOffset +=
-				TftpBlkSize * TFTP_SEQUENCE_SIZE;
-			printf("\n\t %lu MB received\n\t ",
-				TftpBlockWrapOffset>>20);
-		}
-#ifdef CONFIG_TFTP_TSIZE
-		else if (TftpTsize) {
-			while (TftpNumchars <
-			       NetBootFileXferSize * 50 / TftpTsize) {
-				putc('#');
-				TftpNumchars++;
-			}
-		}
-#endif
-		else {
-			if (((TftpBlock - 1) % 10) == 0)
-				putc('#');
-			else if ((TftpBlock % (10 * HASHES_PER_LINE)) == 0)
-				puts("\n\t ");
-		}
-
 		if (TftpState == STATE_SEND_RRQ)
 			debug("Server did not acknowledge timeout option!\n");
 
@@ -428,17 +501,21 @@ TftpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 			TftpLastBlock = 0;
 			TftpBlockWrap = 0;
 			TftpBlockWrapOffset = 0;
+			TftpWindowCount = 0;
+			TftpGapBlock = -1;
 
 #ifdef CONFIG_MCAST_TFTP
 			if (Multicast) { /* start!=1 common if mcast */
 				TftpLastBlock = TftpBlock - 1;
 			} else
 #endif
-			if (TftpBlock != 1) {	/* Assertion */
+			/* with a window, a lost block 1 is just a gap */
+			if (TftpBlock != 1 && TftpWindowSize == 1) {
 				printf("\nTFTP error: "
 				       "First block is not block 1 (%ld)\n"
 				       "Starting again\n\n",
 					TftpBlock);
+				TftpRxPlace(0);
 				NetStartAgain();
 				break;
 			}
@@ -451,15 +528,75 @@ TftpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 			break;
 		}
 
+		if (TftpWindowSize > 1 &&
+		    TftpBlock != ((TftpLastBlock + 1) & 0xffff)) {
+			/*
+			 * A block went missing. Blocks ahead of the gap are
+			 * dropped and the last block in order is ACKed, once
+			 * per gap, so that the server resends the window
+			 * from there; the rest of the window already in
+			 * flight is dropped quietly, as are stale
+			 * retransmissions of older blocks. A timeout ACKs
+			 * again.
+			 */
+			int ahead = ((TftpBlock - TftpLastBlock) & 0xffff) <
+				    0x8000;
+
+			/* TftpSend() and TftpTimeout() ACK TftpBlock */
+			TftpBlock = TftpLastBlock;
+			if (ahead && TftpGapBlock != TftpLastBlock) {
+				TftpGapBlock = TftpLastBlock;
+				TftpWindowCount = 0;
+				TftpSend();
+			}
+			break;
+		}
+
+		/*
+		 * RFC1350 specifies that the first data packet will
+		 * have sequence number 1. If we receive a sequence
+		 * number of 0 this means that there was a wrap
+		 * around of the (16 bit) counter.
+		 */
+		if (TftpBlock == 0) {
+			TftpBlockWrap++;
+			TftpBlockWrapOffset +=
+				TftpBlkSize * TFTP_SEQUENCE_SIZE;
+			printf("\n\t %lu MB received\n\t ",
+				TftpBlockWrapOffset>>20);
+		}
+#ifdef CONFIG_TFTP_TSIZE
+		else if (TftpTsize) {
+			while (TftpNumchars <
+			       NetBootFileXferSize * 50 / TftpTsize) {
+				putc('#');
+				TftpNumchars++;
+			}
+		}
+#endif
+		else {
+			if (((TftpBlock - 1) % 10) == 0)
+				putc('#');
+			else if ((TftpBlock % (10 * HASHES_PER_LINE)) == 0)
+				puts("\n\t ");
+		}
+
 		TftpLastBlock = TftpBlock;
+		TftpGapBlock = -1;
 		TftpTimeoutCountMax = TIMEOUT_COUNT;
 		NetSetTimeout(TftpTimeoutMSecs, TftpTimeout);
 
 		store_block(TftpBlock - 1, pkt + 2, len);
+		if (NetState == NETLOOP_FAIL) {
+			/* no ACK: that would arm the next window again */
+			TftpRxPlace(0);
+			break;
+		}
 
 		/*
 		 *	Acknowledge the block just received, which will prompt
-		 *	the remote for the next one.
+		 *	the remote for the next one. With a window only the
+		 *	last block of each window, or of the file, is ACKed.
 		 */
 #ifdef CONFIG_MCAST_TFTP
 		/* if I am the MasterClient, actively calculate what my next
@@ -478,6 +615,7 @@ TftpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 					printf("tftpfile too big\n");
 					/* try to double it and retry */
 					Mapsize <<= 1;
+					TftpRxPlace(0);
 					mcast_cleanup();
 					NetStartAgain();
 					return;
@@ -486,7 +624,10 @@ TftpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 			}
 		}
 #endif
-		TftpSend();
+		if (++TftpWindowCount >= TftpWindowSize || len < TftpBlkSize) {
+			TftpWindowCount = 0;
+			TftpSend();
+		}
 
 #ifdef CONFIG_MCAST_TFTP
 		if (Multicast) {
@@ -511,6 +652,7 @@ TftpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 			}
 #endif
 			puts("\ndone\n");
+			TftpRxPlace(0);
 			NetState = NETLOOP_SUCCESS;
 		}
 		break;
@@ -518,6 +660,7 @@ TftpHandler(uchar *pkt, unsigned dest, IPaddr_t sip, unsigned src,
 	case TFTP_ERROR:
 		printf("\nTFTP error: '%s' (%d)\n",
 		       pkt + 2, ntohs(*(ushort *)pkt));
+		TftpRxPlace(0);
 
 		switch (ntohs(*(ushort *)pkt)) {
 		case TFTP_ERR_FILE_NOT_FOUND:
@@ -549,6 +692,7 @@ TftpTimeout(void)
 {
 	if (++TftpTimeoutCount > TftpTimeoutCountMax) {
 		puts("\nRetry count exceeded; starting again\n");
+		TftpRxPlace(0);
 #ifdef CONFIG_MCAST_TFTP
 		mcast_cleanup();
 #endif
@@ -556,6 +700,9 @@ TftpTimeout(void)
 	} else {
 		puts("T ");
 		NetSetTimeout(TftpTimeoutMSecs, TftpTimeout);
+		/* re-ACK the last block in order, restarting the window */
+		TftpWindowCount = 0;
+		TftpGapBlock = -1;
 		if (TftpState != STATE_RECV_WRQ)
 			TftpSend();
 	}
@@ -566,6 +713,7 @@ void
 TftpStart(void)
 {
 	char *ep;             /* Environment pointer */
+	long window;
 
 	/*
 	 * Allow the user to choose TFTP blocksize and timeout.
@@ -574,6 +722,28 @@ TftpStart(void)
 	ep = getenv("tftpblocksize");
 	if (ep != NULL)
 		TftpBlkSizeOption = simple_strtol(ep, NULL, 10);
+	else
+		TftpBlkSizeOption = TFTP_MTU_BLOCKSIZE;
+#ifndef CONFIG_IP_DEFRAG
+	/* without reassembly a block has to fit in one frame */
+	if (TftpBlkSizeOption > TFTP_MAX_BLOCKSIZE)
+		TftpBlkSizeOption = TFTP_MAX_BLOCKSIZE;
+#ifdef CONFIG_NET_MTU
+	/* ... of the device in use, which may not take jumbo frames */
+	if (eth_get_dev() && eth_get_dev()->mtu &&
+	    TftpBlkSizeOption > eth_get_dev()->mtu - IP_HDR_SIZE - 4)
+		TftpBlkSizeOption = eth_get_dev()->mtu - IP_HDR_SIZE - 4;
+#endif
+#endif
+
+	ep = getenv("tftpwindowsize");
+	window = ep ? simple_strtol(ep, NULL, 10) : TFTP_WINDOWSIZE;
+	if (window < 1)
+		window = 1;
+	/* a window has to fit in the receive buffers */
+	if (window > PKTBUFSRX)
+		window = PKTBUFSRX;
+	TftpWindowSizeOption = window;
 
 	ep = getenv("tftptimeout");
 	if (ep != NULL)
@@ -586,8 +756,8 @@ TftpStart(void)
 		TftpTimeoutMSecs = 1000;
 	}
 
-	debug("TFTP blocksize = %i, timeout = %ld ms\n",
-		TftpBlkSizeOption, TftpTimeoutMSecs);
+	debug("TFTP blocksize = %i, windowsize = %i, timeout = %ld ms\n",
+		TftpBlkSizeOption, TftpWindowSizeOption, TftpTimeoutMSecs);
 
 	TftpRemoteIP = NetServerIP;
 	if (BootFile[0] == '\0') {
@@ -668,8 +838,9 @@ TftpStart(void)
 
 	/* zero out server ether in case the server ip has changed */
 	memset(NetServerEther, 0, 6);
-	/* Revert TftpBlkSize to dflt */
+	/* Revert TftpBlkSize and TftpWindowSize to dflt */
 	TftpBlkSize = TFTP_BLOCK_SIZE;
+	TftpWindowSize = 1;
 #ifdef CONFIG_MCAST_TFTP
 	mcast_cleanup();
 #endif
@@ -700,8 +871,9 @@ TftpStartServer(void)
 	TftpTimeoutMSecs = TIMEOUT;
 	NetSetTimeout(TftpTimeoutMSecs, TftpTimeout);
 
-	/* Revert TftpBlkSize to dflt */
+	/* Revert TftpBlkSize and TftpWindowSize to dflt */
 	TftpBlkSize = TFTP_BLOCK_SIZE;
+	TftpWindowSize = 1;
 	TftpBlock = 0;
 	TftpOurPort = WELL_KNOWN_PORT;
 
@@ -191,7 +191,7 @@ static void ether_post_init (int devnum, int hw_addr)
 #endif
 		mtdcr (MAL0_RXCTP1R, &rx);
 		/* set RX buffer size */
-		mtdcr (MAL0_RCBS1, PKTSIZE_ALIGN / 16);
+		mtdcr (MAL0_RCBS1, MAL_BUF_SIZE / 16);
 		break;
 	case 0:
 	default:
@@ -203,7 +203,7 @@ static void ether_post_init (int devnum, int hw_addr)
 		mtdcr (MAL0_TXCTP0R, &tx);
 		mtdcr (MAL0_RXCTP0R, &rx);
 		/* set RX buffer size */
-		mtdcr (MAL0_RCBS0, PKTSIZE_ALIGN / 16);
+		mtdcr (MAL0_RCBS0, MAL_BUF_SIZE / 16);
 		break;
 	}
 